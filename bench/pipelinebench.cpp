@@ -0,0 +1,307 @@
+/**
+ * Headless image pipeline benchmark.
+ *
+ * Runs Capture -> Preprocessor -> Converter on their own threads, as the
+ * ImageViewer does, but without any window. Frames come from the
+ * FakeCamera or a replayed recording, polled as fast as the capture thread
+ * allows unless the recording is replayed in real time.
+ * Reports throughput, per-stage latency percentiles, and allocation counts
+ * over the measured frames. Only matrix buffers in host memory are counted,
+ * so OpenCL buffers are left out unless OpenCL is disabled.
+ *
+ * Usage:
+ *     minotaur-bench [--video file] [--realtime] [--frames n] [--warmup n] [--modifier n[,n...]]
+ *                    [--size WxH] [--analysis-scale s] [--gate t] [--coarse-squares]
+ *                    [--queue-depth n] [--drop-newest] [--interval ms] [--no-opencl]
+ */
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTimer>
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <code/camera/camerathread.h>
+#include <code/camera/capture.h>
+#include <code/camera/converter.h>
+#include <code/camera/frameinfo.h>
+#include <code/camera/pipelinestats.h>
+#include <code/camera/preprocessor.h>
+#include <code/camera/replaycamera.h>
+#include <code/simulator/fakecamera.h>
+#include <code/utility/utility.h>
+#include <code/video/modifierchain.h>
+#include <code/video/modify.h>
+#include <code/video/squares.h>
+
+Q_DECLARE_METATYPE(cv::UMat);
+
+// Number and size of C++ heap allocations on all threads
+static std::atomic<std::size_t> s_allocs(0);
+static std::atomic<std::size_t> s_alloc_bytes(0);
+// Number of OpenCV matrix buffers allocated
+static std::atomic<std::size_t> s_mat_allocs(0);
+
+void *operator new(std::size_t size) {
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    s_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) { return ptr; }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+/**
+ * Matrix allocator that counts buffer allocations and otherwise defers
+ * to the default allocator. Buffers are freed by the default allocator
+ * directly since it is recorded as their owner.
+ */
+class CountingAllocator : public cv::MatAllocator {
+public:
+    explicit CountingAllocator(cv::MatAllocator *base) :
+        m_base(base) {}
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data,
+                           size_t *step, int flags, cv::UMatUsageFlags usage) const override {
+        if (!data) { s_mat_allocs.fetch_add(1, std::memory_order_relaxed); }
+        return m_base->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+
+    bool allocate(cv::UMatData *data, int flags, cv::UMatUsageFlags usage) const override {
+        return m_base->allocate(data, flags, usage);
+    }
+
+    void deallocate(cv::UMatData *data) const override {
+        m_base->deallocate(data);
+    }
+
+private:
+    cv::MatAllocator *m_base;
+};
+
+/**
+ * Counters captured at the start and end of the measured window.
+ */
+struct Snapshot {
+    void take(std::size_t t_converted, const Preprocessor &pp) {
+        time = pipeline_clock::now();
+        converted = t_converted;
+        queued = pp.frames_queued();
+        dropped = pp.frames_dropped();
+        reused = pp.frames_reused();
+        allocs = s_allocs.load();
+        alloc_bytes = s_alloc_bytes.load();
+        mat_allocs = s_mat_allocs.load();
+    }
+
+    pipeline_clock::time_point time;
+    std::size_t converted;
+    std::size_t queued;
+    std::size_t dropped;
+    std::size_t reused;
+    std::size_t allocs;
+    std::size_t alloc_bytes;
+    std::size_t mat_allocs;
+};
+
+static void use_coarse_squares(VideoModifier *modifier) {
+    if (auto *squares = dynamic_cast<Squares *>(modifier)) {
+        squares->set_coarse_to_fine(true);
+    } else if (auto *chain = dynamic_cast<ModifierChain *>(modifier)) {
+        for (const std::shared_ptr<VideoModifier> &next : chain->modifiers()) {
+            use_coarse_squares(next.get());
+        }
+    }
+}
+
+static double per_frame(std::size_t count, std::size_t frames) {
+    return frames ? static_cast<double>(count) / frames : 0.0;
+}
+
+static void report(const Snapshot &begin, const Snapshot &end, const Converter &converter) {
+    std::size_t frames = end.converted - begin.converted;
+    std::size_t queued = end.queued - begin.queued;
+    std::size_t dropped = end.dropped - begin.dropped;
+    double seconds = std::chrono::duration<double>(end.time - begin.time).count();
+    std::printf("frames captured   %zu\n", queued);
+    std::printf("frames converted  %zu\n", frames);
+    std::printf("frames dropped    %zu\n", dropped);
+    std::printf("frames reused     %zu\n", end.reused - begin.reused);
+    std::printf("elapsed           %.3f s\n", seconds);
+    std::printf("capture rate      %.1f fps\n", seconds > 0 ? queued / seconds : 0.0);
+    std::printf("throughput        %.1f fps\n", seconds > 0 ? frames / seconds : 0.0);
+    std::printf("heap allocations  %zu (%.1f per frame, %.0f bytes per frame)\n",
+                end.allocs - begin.allocs,
+                per_frame(end.allocs - begin.allocs, frames),
+                per_frame(end.alloc_bytes - begin.alloc_bytes, frames));
+    std::printf("mat allocations   %zu (%.1f per frame)%s\n",
+                end.mat_allocs - begin.mat_allocs,
+                per_frame(end.mat_allocs - begin.mat_allocs, frames),
+                cv::ocl::useOpenCL() ? ", OpenCL buffers not counted, see --no-opencl" : "");
+    std::printf("display buffers   %zu\n", converter.buffers_allocated());
+    // END_TO_END is measured from capture to conversion since nothing is painted
+    std::printf("\nlatency (END_TO_END is capture to conversion)\n%s",
+                PipelineStats::get().summary().c_str());
+}
+
+int main(int argc, char *argv[]) {
+    qRegisterMetaType<cv::UMat>();
+    qRegisterMetaType<std::shared_ptr<VideoModifier>>();
+    qRegisterMetaType<FrameInfo>();
+
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless image pipeline benchmark");
+    parser.addHelpOption();
+    QCommandLineOption video_option("video", "Read frames from a video file instead of the FakeCamera.", "file");
+    QCommandLineOption realtime_option("realtime", "Replay the video with its recorded timing.");
+    QCommandLineOption frames_option("frames", "Number of frames to measure, 0 to run to the end of the video.", "n", "300");
+    QCommandLineOption warmup_option("warmup", "Number of frames to convert before measuring.", "n", "30");
+    QCommandLineOption modifier_option("modifier", "Video modifiers: 0 none, 1 squares, 2 shape detector, 4 blob detector, 5 wall detector. Several comma separated modifiers run as a chain.", "n[,n...]", "0");
+    QCommandLineOption size_option("size", "Converter output size.", "WxH", "640x480");
+    QCommandLineOption scale_option("analysis-scale", "Scale at which the modifier analyzes frames.", "s", "1.0");
+    QCommandLineOption gate_option("gate", "Skip analysis of frames whose block means change by at most t gray levels, 0 to analyze every frame.", "t", "0");
+    QCommandLineOption coarse_option("coarse-squares", "Search for squares coarse to fine.");
+    QCommandLineOption depth_option("queue-depth", "Preprocessor queue depth.", "n", "1");
+    QCommandLineOption newest_option("drop-newest", "Drop new frames instead of old ones when the queue is full.");
+    QCommandLineOption interval_option("interval", "Milliseconds between captured frames.", "ms", "0");
+    QCommandLineOption opencl_option("no-opencl", "Disable OpenCL.");
+    parser.addOptions({
+        video_option, realtime_option, frames_option, warmup_option, modifier_option, size_option,
+        scale_option, gate_option, coarse_option, depth_option, newest_option, interval_option, opencl_option
+    });
+    parser.process(app);
+
+    std::size_t frames = parser.value(frames_option).toUInt();
+    std::size_t warmup = parser.value(warmup_option).toUInt();
+    std::vector<int> modifiers;
+    for (const QString &modifier : parser.value(modifier_option).split(',')) {
+        modifiers.push_back(modifier.toInt());
+    }
+    QStringList size = parser.value(size_option).split('x');
+    if (size.size() != 2 || size[0].toInt() <= 0 || size[1].toInt() <= 0) {
+        std::fprintf(stderr, "Invalid size: %s\n", qPrintable(parser.value(size_option)));
+        return 1;
+    }
+    if (parser.isSet(video_option) && !QFileInfo(parser.value(video_option)).isFile()) {
+        std::fprintf(stderr, "No such video file: %s\n", qPrintable(parser.value(video_option)));
+        return 1;
+    }
+    if (frames == 0 && !parser.isSet(video_option)) {
+        std::fprintf(stderr, "The FakeCamera never ends, --frames must be positive\n");
+        return 1;
+    }
+    // The tracker needs the MainWindow and user input
+    for (int modifier : modifiers) {
+        if (modifier != VideoModifier::NONE &&
+            modifier != VideoModifier::SQUARES &&
+            modifier != VideoModifier::SHAPEDETECT &&
+            modifier != VideoModifier::BLOBDETECT &&
+            modifier != VideoModifier::WALLDETECT) {
+            std::fprintf(stderr, "Modifier %d cannot run headless\n", modifier);
+            return 1;
+        }
+    }
+    if (parser.isSet(opencl_option)) { cv::ocl::setUseOpenCL(false); }
+
+    cv::MatAllocator *default_allocator = cv::Mat::getDefaultAllocator();
+    CountingAllocator allocator(default_allocator);
+    cv::Mat::setDefaultAllocator(&allocator);
+
+    auto capture = std::make_unique<Capture>();
+    auto preprocessor = std::make_unique<Preprocessor>();
+    auto converter = std::make_unique<Converter>(size[0].toInt(), size[1].toInt());
+    preprocessor->configure_queue(
+        parser.value(depth_option).toInt(),
+        parser.isSet(newest_option) ? Preprocessor::DROP_NEWEST : Preprocessor::DROP_OLDEST
+    );
+    std::shared_ptr<VideoModifier> modifier = VideoModifier::get_modifier(modifiers);
+    if (parser.isSet(coarse_option)) { use_coarse_squares(modifier.get()); }
+    preprocessor->use_modifier(modifier);
+    preprocessor->analysis_scale_changed(parser.value(scale_option).toDouble());
+    preprocessor->analysis_gate_changed(parser.value(gate_option).toDouble(), std::numeric_limits<int>::max());
+
+    // Declared after the pipeline objects so that the threads
+    // are stopped before the objects are destroyed
+    IThread thread_capture;
+    IThread thread_preprocessor;
+    IThread thread_converter;
+    thread_capture.start();
+    thread_preprocessor.start();
+    thread_converter.start();
+    capture->moveToThread(&thread_capture);
+    preprocessor->moveToThread(&thread_preprocessor);
+    converter->moveToThread(&thread_converter);
+
+    std::atomic<std::size_t> converted(0);
+    QObject::connect(capture.get(), &Capture::frame_ready, preprocessor.get(), &Preprocessor::preprocess_frame,
+                     Qt::DirectConnection);
+    QObject::connect(preprocessor.get(), &Preprocessor::frame_processed, converter.get(), &Converter::process_frame);
+    // Runs on the converter thread
+    QObject::connect(converter.get(), &Converter::image_ready, [&converted](const QImage &, const FrameInfo &info) {
+        if (info.seq) {
+            PipelineStats::get().record(PipelineStats::END_TO_END, info.captured, pipeline_clock::now());
+        }
+        ++converted;
+    });
+
+    enum { WARMUP, MEASURE, DRAIN } phase = WARMUP;
+    bool stopped = false;
+    Snapshot begin;
+    Snapshot end;
+    QObject::connect(capture.get(), &Capture::capture_stopped, &app, [&stopped] { stopped = true; });
+
+    // Poll the pipeline from the main thread
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, [&] {
+        std::size_t count = converted.load();
+        if (phase == WARMUP && (count >= warmup || stopped)) {
+            if (stopped) { std::fprintf(stderr, "Video ended during warmup\n"); }
+            PipelineStats::get().reset();
+            begin.take(count, *preprocessor);
+            phase = MEASURE;
+        }
+        if (phase == MEASURE && ((frames && count - begin.converted >= frames) || stopped)) {
+            end.take(count, *preprocessor);
+            QMetaObject::invokeMethod(capture.get(), "stop_capture", Qt::QueuedConnection);
+            phase = DRAIN;
+        }
+        // Wait for frames still in flight so that threads are idle on exit
+        if (phase == DRAIN && stopped &&
+            preprocessor->idle() &&
+            converted.load() >= preprocessor->frames_processed()) {
+            poll.stop();
+            report(begin, end, *converter);
+            app.quit();
+        }
+    });
+    poll.start(5);
+
+    QMetaObject::invokeMethod(capture.get(), "set_frame_interval", Qt::QueuedConnection,
+                              Q_ARG(int, parser.value(interval_option).toInt()));
+    if (parser.isSet(video_option)) {
+        int mode = parser.isSet(realtime_option) ? ReplayCamera::REALTIME : ReplayCamera::MAX_SPEED;
+        QMetaObject::invokeMethod(capture.get(), "start_replay", Qt::QueuedConnection,
+                                  Q_ARG(QString, parser.value(video_option)), Q_ARG(int, mode));
+    } else {
+        QMetaObject::invokeMethod(capture.get(), "start_capture", Qt::QueuedConnection,
+                                  Q_ARG(int, FakeCamera::FAKE_CAMERA));
+    }
+
+    int ret = app.exec();
+    cv::Mat::setDefaultAllocator(default_allocator);
+    return ret;
+}
@@ -0,0 +1,171 @@
+/**
+ * Compares the ShapeDetect denoisers on synthetic frames.
+ *
+ * Each frame shows the same known triangles, rectangles, and circles under
+ * fresh Gaussian noise, as a stationary scene looks to a camera. Every
+ * denoiser analyzes the same frames, and the benchmark reports the analysis
+ * time and how many of the known shapes were found with the right label.
+ *
+ * Usage:
+ *     minotaur-shapebench [--frames n] [--warmup n] [--noise sigma]
+ *                         [--size WxH] [--no-opencl]
+ */
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QStringList>
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <code/video/shapedetect.h>
+
+namespace {
+    // Random seed, so that every denoiser sees the same noise
+    const int NOISE_SEED = 1234;
+    // Largest distance between a found and a known shape center
+    const double MATCH_DISTANCE = 10.0;
+}
+
+/**
+ * A shape drawn onto the synthetic scene.
+ */
+struct KnownShape {
+    std::string label;
+    cv::Point2d center;
+};
+
+static void add_polygon(cv::Mat &scene, std::vector<KnownShape> &shapes,
+                        const std::string &label, const std::vector<cv::Point> &points, int shade) {
+    cv::fillConvexPoly(scene, points, cv::Scalar::all(shade), cv::LINE_AA);
+    cv::Moments m = cv::moments(points);
+    shapes.push_back({label, {m.m10 / m.m00, m.m01 / m.m00}});
+}
+
+/**
+ * Draw a row each of rectangles, triangles, and circles of increasing size.
+ */
+static cv::Mat make_scene(const cv::Size &size, std::vector<KnownShape> &shapes) {
+    cv::Mat scene(size, CV_8UC1, cv::Scalar::all(110));
+    int cell = size.width / 4;
+    int row = size.height / 3;
+    for (int i = 0; i < 3; ++i) {
+        int cx = cell * (i + 1);
+        int r = 15 + 10 * i;
+        int shade = i % 2 ? 30 : 210;
+        add_polygon(scene, shapes, "RECT", {
+            {cx - r, row / 2 - r}, {cx + r, row / 2 - r}, {cx + r, row / 2 + r}, {cx - r, row / 2 + r}
+        }, shade);
+        add_polygon(scene, shapes, "TRI", {
+            {cx, row + row / 2 - r}, {cx + r, row + row / 2 + r}, {cx - r, row + row / 2 + r}
+        }, shade);
+        cv::Point center(cx, 2 * row + row / 2);
+        cv::circle(scene, center, r, cv::Scalar::all(shade), cv::FILLED, cv::LINE_AA);
+        shapes.push_back({"CIR", center});
+    }
+    return scene;
+}
+
+/**
+ * Accuracy and timing of a single denoiser.
+ */
+struct Result {
+    std::vector<double> ms;
+    std::size_t expected = 0;
+    std::size_t found = 0;
+    std::size_t labels = 0;
+};
+
+static std::size_t count_found(const ShapeDetect::label_list &labels, const std::vector<KnownShape> &shapes) {
+    std::size_t found = 0;
+    for (const KnownShape &shape : shapes) {
+        for (const auto &label : labels) {
+            cv::Rect r = cv::boundingRect(label.second);
+            cv::Point2d center(r.x + r.width / 2.0, r.y + r.height / 2.0);
+            if (label.first == shape.label && cv::norm(center - shape.center) <= MATCH_DISTANCE) {
+                ++found;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+static Result run(int denoiser, const cv::Mat &scene, const std::vector<KnownShape> &shapes,
+                  std::size_t frames, std::size_t warmup, double noise) {
+    ShapeDetect detector(denoiser);
+    cv::RNG rng(NOISE_SEED);
+    cv::Mat noisy;
+    cv::Mat offsets(scene.size(), CV_16SC1);
+    Result result;
+    for (std::size_t i = 0; i < warmup + frames; ++i) {
+        rng.fill(offsets, cv::RNG::NORMAL, 0, noise);
+        cv::add(scene, offsets, noisy, cv::noArray(), CV_8U);
+        cv::UMat frame = noisy.getUMat(cv::ACCESS_READ);
+        auto start = std::chrono::steady_clock::now();
+        detector.analyze(frame, 1.0);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        // The temporal filter needs a few frames before it settles
+        if (i < warmup) { continue; }
+        result.ms.push_back(elapsed.count());
+        result.expected += shapes.size();
+        result.found += count_found(detector.labels(), shapes);
+        result.labels += detector.labels().size();
+    }
+    return result;
+}
+
+static void report(int denoiser, Result &result) {
+    std::sort(result.ms.begin(), result.ms.end());
+    double total = 0;
+    for (double ms : result.ms) { total += ms; }
+    std::size_t n = result.ms.size();
+    std::printf("%-10s %9.2f %9.2f %9.2f %9.1f%% %9.1f\n",
+                ShapeDetect::denoiser_name(denoiser),
+                n ? total / n : 0.0,
+                n ? result.ms[n / 2] : 0.0,
+                n ? result.ms[std::min(n - 1, n * 95 / 100)] : 0.0,
+                result.expected ? 100.0 * result.found / result.expected : 0.0,
+                n ? static_cast<double>(result.labels) / n : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ShapeDetect denoiser benchmark");
+    parser.addHelpOption();
+    QCommandLineOption frames_option("frames", "Number of frames to measure per denoiser.", "n", "100");
+    QCommandLineOption warmup_option("warmup", "Number of frames to analyze before measuring.", "n", "5");
+    QCommandLineOption noise_option("noise", "Standard deviation of the added noise.", "sigma", "20");
+    QCommandLineOption size_option("size", "Frame size.", "WxH", "640x480");
+    QCommandLineOption opencl_option("no-opencl", "Disable OpenCL.");
+    parser.addOptions({frames_option, warmup_option, noise_option, size_option, opencl_option});
+    parser.process(app);
+
+    std::size_t frames = parser.value(frames_option).toUInt();
+    std::size_t warmup = parser.value(warmup_option).toUInt();
+    double noise = parser.value(noise_option).toDouble();
+    QStringList size = parser.value(size_option).split('x');
+    if (size.size() != 2 || size[0].toInt() <= 0 || size[1].toInt() <= 0) {
+        std::fprintf(stderr, "Invalid size: %s\n", qPrintable(parser.value(size_option)));
+        return 1;
+    }
+    if (parser.isSet(opencl_option)) { cv::ocl::setUseOpenCL(false); }
+
+    std::vector<KnownShape> shapes;
+    cv::Mat scene = make_scene(cv::Size(size[0].toInt(), size[1].toInt()), shapes);
+
+    std::printf("%zu shapes, noise sigma %.1f, %zu frames\n\n", shapes.size(), noise, frames);
+    std::printf("%-10s %9s %9s %9s %10s %9s\n", "denoiser", "mean ms", "p50 ms", "p95 ms", "found", "labels");
+    for (int denoiser = 0; denoiser < ShapeDetect::NUM_DENOISERS; ++denoiser) {
+        Result result = run(denoiser, scene, shapes, frames, warmup, noise);
+        report(denoiser, result);
+    }
+    return 0;
+}
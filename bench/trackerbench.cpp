@@ -0,0 +1,229 @@
+/**
+ * Compares the tracker algorithms on simulated frames.
+ *
+ * The simulated robot drives around a square while the FakeCamera draws it,
+ * and is periodically hidden to force the trackers to lose it. Every
+ * tracker type follows the same path at every analysis scale, starting
+ * from the true robot box, and is scored against the true box each frame.
+ *
+ * A frame is a success when the tracker is tracking and its box overlaps
+ * the true box by at least the IoU threshold. The benchmark reports the
+ * mean IoU over all frames, the number of times the tracker went from
+ * success to failure, the mean frames and time taken to succeed again,
+ * and the tracker update rate.
+ *
+ * Usage:
+ *     minotaur-trackerbench [--frames n] [--types n[,n...]] [--scales s[,s...]]
+ *                           [--side n] [--occlusion-period n] [--occlusion-length n]
+ *                           [--min-iou x] [--no-opencl]
+ */
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QStringList>
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <code/simulator/fakecamera.h>
+#include <code/simulator/globalsim.h>
+#include <code/video/tracker.h>
+
+Q_DECLARE_METATYPE(cv::UMat);
+
+/**
+ * Options shared by every run.
+ */
+struct Config {
+    std::size_t frames;
+    // Frames spent driving along each side of the square
+    std::size_t side;
+    // The robot is hidden for occlusion_length frames every occlusion_period frames
+    std::size_t occlusion_period;
+    std::size_t occlusion_length;
+    double min_iou;
+};
+
+/**
+ * Accuracy and timing of a tracker type at an analysis scale.
+ */
+struct Result {
+    double iou_total = 0;
+    std::size_t frames = 0;
+    std::size_t failures = 0;
+    std::size_t recoveries = 0;
+    std::size_t recovery_frames = 0;
+    double recovery_ms = 0;
+    double update_ms = 0;
+};
+
+static double iou(const cv::Rect2d &a, const cv::Rect2d &b) {
+    double overlap = (a & b).area();
+    double total = a.area() + b.area() - overlap;
+    return total > 0 ? overlap / total : 0;
+}
+
+/**
+ * Move the robot one step along the square path.
+ */
+static void drive(GlobalSim &sim, std::size_t frame, std::size_t side) {
+    switch (frame / side % 4) {
+        case 0:
+            sim.robot_right();
+            break;
+        case 1:
+            sim.robot_down();
+            break;
+        case 2:
+            sim.robot_left();
+            break;
+        default:
+            sim.robot_up();
+            break;
+    }
+}
+
+static Result run(int type, double scale, const Config &config) {
+    typedef std::chrono::steady_clock clock;
+    auto sim = std::make_shared<GlobalSim>();
+    FakeCamera camera(sim);
+    __tracker tracker(type);
+    tracker.track_box(FakeCamera::get_robot_rect(sim.get()));
+
+    Result result;
+    cv::UMat frame;
+    cv::UMat analysis;
+    bool success = true;
+    std::size_t lost_frames = 0;
+    clock::time_point lost_at;
+    for (std::size_t i = 0; i < config.frames; ++i) {
+        drive(*sim, i, config.side);
+        camera >> frame;
+        cv::Rect2d truth = FakeCamera::get_robot_rect(sim.get());
+        if (i % config.occlusion_period >= config.occlusion_period - config.occlusion_length) {
+            cv::rectangle(frame, truth, cv::Scalar::all(0), cv::FILLED);
+        }
+        if (scale == 1.0) {
+            analysis = frame;
+        } else {
+            cv::resize(frame, analysis, cv::Size(), scale, scale, cv::INTER_AREA);
+        }
+
+        clock::time_point start = clock::now();
+        tracker.update_track(analysis, scale);
+        clock::time_point end = clock::now();
+        result.update_ms += std::chrono::duration<double, std::milli>(end - start).count();
+
+        bool tracking = tracker.state() == __tracker::TRACKING;
+        double overlap = tracking ? iou(tracker.bounding_box(), truth) : 0;
+        result.iou_total += overlap;
+        ++result.frames;
+
+        bool now_success = tracking && overlap >= config.min_iou;
+        if (success && !now_success) {
+            ++result.failures;
+            lost_frames = 0;
+            lost_at = end;
+        } else if (!success && now_success) {
+            ++result.recoveries;
+            result.recovery_frames += lost_frames;
+            result.recovery_ms += std::chrono::duration<double, std::milli>(end - lost_at).count();
+        }
+        if (!now_success) { ++lost_frames; }
+        success = now_success;
+    }
+    return result;
+}
+
+static void report(int type, double scale, const Result &result) {
+    std::size_t n = result.frames;
+    std::size_t r = result.recoveries;
+    std::printf("%-11s %6.2f %9.3f %9zu %9zu %11.1f %11.1f %9.1f\n",
+                __tracker::type_name(type), scale,
+                n ? result.iou_total / n : 0.0,
+                result.failures, r,
+                r ? static_cast<double>(result.recovery_frames) / r : 0.0,
+                r ? result.recovery_ms / r : 0.0,
+                result.update_ms > 0 ? 1000.0 * n / result.update_ms : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    qRegisterMetaType<cv::UMat>();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Tracker accuracy and throughput benchmark");
+    parser.addHelpOption();
+    QCommandLineOption frames_option("frames", "Number of frames per run.", "n", "600");
+    QCommandLineOption types_option(
+        "types", "Comma-separated tracker types (0 Boosting, 1 MIL, 2 KCF, 3 TLD, 4 MedianFlow, 5 GOTURN).",
+        "n[,n...]");
+    QCommandLineOption scales_option("scales", "Comma-separated analysis scales.", "s[,s...]", "1.0,0.5");
+    QCommandLineOption side_option("side", "Frames spent on each side of the square path.", "n", "40");
+    QCommandLineOption period_option("occlusion-period", "Frames between the starts of occlusions.", "n", "150");
+    QCommandLineOption length_option("occlusion-length", "Frames the robot stays hidden.", "n", "10");
+    QCommandLineOption iou_option("min-iou", "Smallest IoU counted as a success.", "x", "0.3");
+    QCommandLineOption opencl_option("no-opencl", "Disable OpenCL.");
+    parser.addOptions({frames_option, types_option, scales_option, side_option,
+                       period_option, length_option, iou_option, opencl_option});
+    parser.process(app);
+
+    Config config;
+    config.frames = parser.value(frames_option).toUInt();
+    config.side = parser.value(side_option).toUInt();
+    config.occlusion_period = parser.value(period_option).toUInt();
+    config.occlusion_length = parser.value(length_option).toUInt();
+    config.min_iou = parser.value(iou_option).toDouble();
+    if (config.side == 0 || config.occlusion_period == 0 ||
+        config.occlusion_length >= config.occlusion_period) {
+        std::fprintf(stderr, "Invalid path or occlusion options\n");
+        return 1;
+    }
+    if (parser.isSet(opencl_option)) { cv::ocl::setUseOpenCL(false); }
+
+    std::vector<int> types;
+    if (parser.isSet(types_option)) {
+        for (const QString &type : parser.value(types_option).split(',')) {
+            bool ok = false;
+            int value = type.toInt(&ok);
+            if (!ok || value < 0 || value >= __tracker::NUM_TYPES) {
+                std::fprintf(stderr, "Invalid tracker type: %s\n", qPrintable(type));
+                return 1;
+            }
+            types.push_back(value);
+        }
+    } else {
+        // GOTURN needs its model files in the working directory
+        for (int type = 0; type < __tracker::NUM_TYPES; ++type) {
+#ifndef GOTURN_FOUND
+            if (type == __tracker::GOTURN) { continue; }
+#endif
+            types.push_back(type);
+        }
+    }
+    std::vector<double> scales;
+    for (const QString &scale : parser.value(scales_option).split(',')) {
+        bool ok = false;
+        double value = scale.toDouble(&ok);
+        if (!ok || value <= 0 || value > 1) {
+            std::fprintf(stderr, "Invalid scale: %s\n", qPrintable(scale));
+            return 1;
+        }
+        scales.push_back(value);
+    }
+
+    std::printf("%zu frames, %zu-frame occlusions every %zu frames, success at IoU >= %.2f\n\n",
+                config.frames, config.occlusion_length, config.occlusion_period, config.min_iou);
+    std::printf("%-11s %6s %9s %9s %9s %11s %11s %9s\n",
+                "tracker", "scale", "mean IoU", "failures", "recovered", "recover fr", "recover ms", "fps");
+    for (int type : types) {
+        for (double scale : scales) {
+            report(type, scale, run(type, scale, config));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "calibration.h"
+
+#include <algorithm>
+
+const char *const CameraCalibration::DEFAULT_FILE = "calibration.yml";
+
+namespace {
+    // Fewest chessboard views to estimate the intrinsics from
+    const std::size_t MIN_VIEWS = 5;
+
+    std::shared_ptr<const CameraCalibration> s_current;
+}
+
+static cv::Point2d transform(const cv::Matx33d &h, const cv::Point2d &p) {
+    cv::Vec3d v = h * cv::Vec3d(p.x, p.y, 1.0);
+    return {v[0] / v[2], v[1] / v[2]};
+}
+
+CameraCalibration::CameraCalibration(const cv::Size &size, const cv::Matx33d &camera,
+                                     const cv::Mat &distortion, const cv::Matx33d &homography) :
+    m_size(size),
+    m_camera(camera),
+    m_distortion(distortion.clone()),
+    m_homography(homography),
+    m_inverse(homography.inv()) {}
+
+std::shared_ptr<CameraCalibration> CameraCalibration::from_chessboard(
+    const std::vector<std::vector<cv::Point2f>> &views,
+    const cv::Size &size, const cv::Size &board, double square) {
+    if (views.size() < MIN_VIEWS) { return nullptr; }
+    std::vector<cv::Point3f> corners;
+    std::vector<cv::Point2f> field;
+    for (int r = 0; r < board.height; ++r) {
+        for (int c = 0; c < board.width; ++c) {
+            corners.emplace_back(static_cast<float>(c * square), static_cast<float>(r * square), 0.0f);
+            field.emplace_back(static_cast<float>(c * square), static_cast<float>(r * square));
+        }
+    }
+    std::vector<std::vector<cv::Point3f>> objects(views.size(), corners);
+    cv::Mat camera;
+    cv::Mat distortion;
+    std::vector<cv::Mat> rvecs;
+    std::vector<cv::Mat> tvecs;
+    cv::calibrateCamera(objects, views, size, camera, distortion, rvecs, tvecs);
+    if (!cv::checkRange(camera) || !cv::checkRange(distortion)) { return nullptr; }
+
+    // The field homography is found on the undistorted corners of the last view
+    std::vector<cv::Point2f> undistorted;
+    cv::undistortPoints(views.back(), undistorted, camera, distortion, cv::noArray(), camera);
+    cv::Mat homography = cv::findHomography(undistorted, field);
+    if (homography.empty()) { return nullptr; }
+    return std::make_shared<CameraCalibration>(
+        size, cv::Matx33d(camera), distortion, cv::Matx33d(homography));
+}
+
+std::shared_ptr<CameraCalibration> CameraCalibration::load(const std::string &file) {
+    cv::FileStorage fs(file, cv::FileStorage::READ);
+    if (!fs.isOpened()) { return nullptr; }
+    cv::Size size;
+    cv::Mat camera;
+    cv::Mat distortion;
+    cv::Mat homography;
+    fs["size"] >> size;
+    fs["camera"] >> camera;
+    fs["distortion"] >> distortion;
+    fs["homography"] >> homography;
+    if (size.area() == 0 || camera.size() != cv::Size(3, 3) || homography.size() != cv::Size(3, 3)) {
+        return nullptr;
+    }
+    return std::make_shared<CameraCalibration>(
+        size, cv::Matx33d(camera), distortion, cv::Matx33d(homography));
+}
+
+bool CameraCalibration::save(const std::string &file) const {
+    cv::FileStorage fs(file, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) { return false; }
+    fs << "size" << m_size;
+    fs << "camera" << cv::Mat(m_camera);
+    fs << "distortion" << m_distortion;
+    fs << "homography" << cv::Mat(m_homography);
+    return true;
+}
+
+std::shared_ptr<const CameraCalibration> CameraCalibration::current() {
+    return std::atomic_load(&s_current);
+}
+
+void CameraCalibration::install(std::shared_ptr<const CameraCalibration> calibration) {
+    std::atomic_store(&s_current, std::move(calibration));
+}
+
+const cv::Size &CameraCalibration::size() const {
+    return m_size;
+}
+
+void CameraCalibration::undistort_maps(const cv::Size &size, cv::Mat &map_x, cv::Mat &map_y) const {
+    // The intrinsics scale with the frame, the distortion does not
+    cv::Matx33d camera = m_camera;
+    double sx = static_cast<double>(size.width) / m_size.width;
+    double sy = static_cast<double>(size.height) / m_size.height;
+    camera(0, 0) *= sx;
+    camera(0, 2) *= sx;
+    camera(1, 1) *= sy;
+    camera(1, 2) *= sy;
+    cv::initUndistortRectifyMap(camera, m_distortion, cv::noArray(), camera, size, CV_32FC1, map_x, map_y);
+}
+
+cv::Point2d CameraCalibration::undistort(const cv::Point2d &raw, const cv::Size &frame) const {
+    std::vector<cv::Point2d> in{to_calibration(raw, frame)};
+    std::vector<cv::Point2d> out;
+    cv::undistortPoints(in, out, m_camera, m_distortion, cv::noArray(), m_camera);
+    return from_calibration(out.front(), frame);
+}
+
+cv::Point2d CameraCalibration::distort(const cv::Point2d &undistorted, const cv::Size &frame) const {
+    // Project the viewing ray of the undistorted pixel through the lens
+    cv::Point2d p = to_calibration(undistorted, frame);
+    cv::Vec3d ray = m_camera.inv() * cv::Vec3d(p.x, p.y, 1.0);
+    std::vector<cv::Point3d> in{{ray[0] / ray[2], ray[1] / ray[2], 1.0}};
+    std::vector<cv::Point2d> out;
+    cv::projectPoints(in, cv::Vec3d(), cv::Vec3d(), m_camera, m_distortion, out);
+    return from_calibration(out.front(), frame);
+}
+
+cv::Point2d CameraCalibration::to_field(const cv::Point2d &undistorted, const cv::Size &frame) const {
+    return transform(m_homography, to_calibration(undistorted, frame));
+}
+
+cv::Point2d CameraCalibration::from_field(const cv::Point2d &field, const cv::Size &frame) const {
+    return from_calibration(transform(m_inverse, field), frame);
+}
+
+cv::Point2d CameraCalibration::raw_to_field(const cv::Point2d &raw, const cv::Size &frame) const {
+    return to_field(undistort(raw, frame), frame);
+}
+
+cv::Rect2d CameraCalibration::raw_to_field(const cv::Rect2d &raw, const cv::Size &frame) const {
+    std::vector<cv::Point2d> in{raw.tl(), {raw.x + raw.width, raw.y}, raw.br(), {raw.x, raw.y + raw.height}};
+    for (cv::Point2d &p : in) { p = to_calibration(p, frame); }
+    std::vector<cv::Point2d> out;
+    cv::undistortPoints(in, out, m_camera, m_distortion, cv::noArray(), m_camera);
+    cv::Point2d lo = transform(m_homography, out.front());
+    cv::Point2d hi = lo;
+    for (const cv::Point2d &p : out) {
+        cv::Point2d f = transform(m_homography, p);
+        lo = {std::min(lo.x, f.x), std::min(lo.y, f.y)};
+        hi = {std::max(hi.x, f.x), std::max(hi.y, f.y)};
+    }
+    return {lo, hi};
+}
+
+cv::Matx22d CameraCalibration::raw_to_field_jacobian(const cv::Point2d &raw, const cv::Size &frame) const {
+    // Central differences over a pixel, the map is smooth at that scale
+    cv::Point2d dx = raw_to_field(raw + cv::Point2d(0.5, 0), frame) - raw_to_field(raw - cv::Point2d(0.5, 0), frame);
+    cv::Point2d dy = raw_to_field(raw + cv::Point2d(0, 0.5), frame) - raw_to_field(raw - cv::Point2d(0, 0.5), frame);
+    return {dx.x, dy.x,
+            dx.y, dy.y};
+}
+
+cv::Point2d CameraCalibration::to_calibration(const cv::Point2d &p, const cv::Size &frame) const {
+    if (frame == m_size || frame.area() == 0) { return p; }
+    return {p.x * m_size.width / frame.width, p.y * m_size.height / frame.height};
+}
+
+cv::Point2d CameraCalibration::from_calibration(const cv::Point2d &p, const cv::Size &frame) const {
+    if (frame == m_size || frame.area() == 0) { return p; }
+    return {p.x * frame.width / m_size.width, p.y * frame.height / m_size.height};
+}
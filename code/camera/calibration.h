@@ -0,0 +1,128 @@
+#ifndef MINOTAUR_CPP_CALIBRATION_H
+#define MINOTAUR_CPP_CALIBRATION_H
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Camera intrinsics, lens distortion, and the homography from undistorted
+ * pixels to field units, measured once and stored in a file.
+ *
+ * Frames are analyzed as captured, so boxes and points found in them are
+ * raw pixels, and are mapped to field units as they are published. The
+ * displayed frame is undistorted in the same remap as its rotation and
+ * zoom, so points on the display map to field units through the
+ * homography alone.
+ *
+ * The installed calibration is shared by the image pipeline and the
+ * CompetitionState. Without one, field units are raw pixels.
+ */
+class CameraCalibration {
+public:
+    /**
+     * File the calibration is stored in, in the working directory.
+     */
+    static const char *const DEFAULT_FILE;
+
+    /**
+     * @param size       frame size the intrinsics were measured at
+     * @param camera     camera matrix
+     * @param distortion distortion coefficients
+     * @param homography map from undistorted pixels to field units
+     */
+    CameraCalibration(const cv::Size &size, const cv::Matx33d &camera,
+                      const cv::Mat &distortion, const cv::Matx33d &homography);
+
+    /**
+     * Estimate a calibration from views of a chessboard. The board in the
+     * last view must lie flat on the field; its first inner corner is the
+     * field origin and its rows and columns are the field axes.
+     *
+     * @param views  inner corners found in each view, in row-major order
+     * @param size   frame size
+     * @param board  inner corners per row and column
+     * @param square side of a square in field units
+     * @return the calibration, or nullptr if it could not be estimated
+     */
+    static std::shared_ptr<CameraCalibration> from_chessboard(
+        const std::vector<std::vector<cv::Point2f>> &views,
+        const cv::Size &size, const cv::Size &board, double square);
+
+    /**
+     * @return the stored calibration, or nullptr if there is none
+     */
+    static std::shared_ptr<CameraCalibration> load(const std::string &file);
+
+    bool save(const std::string &file) const;
+
+    /**
+     * @return the installed calibration, or nullptr if there is none.
+     *         Safe to call from any thread.
+     */
+    static std::shared_ptr<const CameraCalibration> current();
+
+    /**
+     * Replace the installed calibration. Safe to call from any thread.
+     */
+    static void install(std::shared_ptr<const CameraCalibration> calibration);
+
+    const cv::Size &size() const;
+
+    /**
+     * Undistortion tables for frames of a size, which map each undistorted
+     * pixel to its raw pixel. The intrinsics are scaled to the size.
+     */
+    void undistort_maps(const cv::Size &size, cv::Mat &map_x, cv::Mat &map_y) const;
+
+    /**
+     * Points are in pixels of a frame of the given size, which need not be
+     * the size the calibration was measured at.
+     *
+     * @param raw   point in a captured frame
+     * @param frame size of the frame
+     * @return the point with the lens distortion removed
+     */
+    cv::Point2d undistort(const cv::Point2d &raw, const cv::Size &frame) const;
+
+    /**
+     * @return the point in the captured frame of an undistorted point
+     */
+    cv::Point2d distort(const cv::Point2d &undistorted, const cv::Size &frame) const;
+
+    cv::Point2d to_field(const cv::Point2d &undistorted, const cv::Size &frame) const;
+
+    cv::Point2d from_field(const cv::Point2d &field, const cv::Size &frame) const;
+
+    cv::Point2d raw_to_field(const cv::Point2d &raw, const cv::Size &frame) const;
+
+    /**
+     * @return the bounding box of the box corners in field units
+     */
+    cv::Rect2d raw_to_field(const cv::Rect2d &raw, const cv::Size &frame) const;
+
+    /**
+     * @return the derivative of raw_to_field at a point, which maps
+     *         small displacements, velocities, and covariances
+     */
+    cv::Matx22d raw_to_field_jacobian(const cv::Point2d &raw, const cv::Size &frame) const;
+
+private:
+    /**
+     * Scale a point from pixels of a frame to pixels of the frame size
+     * the calibration was measured at, and back.
+     */
+    cv::Point2d to_calibration(const cv::Point2d &p, const cv::Size &frame) const;
+
+    cv::Point2d from_calibration(const cv::Point2d &p, const cv::Size &frame) const;
+
+    cv::Size m_size;
+    cv::Matx33d m_camera;
+    cv::Mat m_distortion;
+    cv::Matx33d m_homography;
+    cv::Matx33d m_inverse;
+};
+
+#endif //MINOTAUR_CPP_CALIBRATION_H
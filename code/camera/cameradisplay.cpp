@@ -1,8 +1,13 @@
 #include <QCameraInfo>
 #include <QFileDialog>
 #include <QComboBox>
+#include <QDialogButtonBox>
+#include <QInputDialog>
+#include <QListWidget>
+#include <QSignalBlocker>
 #include <QStandardItemModel>
 #include <QSpinBox>
+#include <QVBoxLayout>
 
 #include "ui_cameradisplay.h"
 #include "cameradisplay.h"
@@ -10,6 +15,7 @@
 #include "actionbox.h"
 #include "actionbutton.h"
 #include "imageviewer.h"
+#include "replaycamera.h"
 
 #include "../utility/logger.h"
 #include "../utility/utility.h"
@@ -62,6 +68,8 @@ static void populate_camera_box(QComboBox *box) {
     }
     // Add the simulated camera
     box->addItem("Simulated", QVariant::fromValue(i));
+    // Add the recording replay
+    box->addItem("Replay...", QVariant::fromValue(i + 1));
 }
 
 static void populate_effect_box(QComboBox *box) {
@@ -94,7 +102,9 @@ CameraDisplay::CameraDisplay(QWidget *parent) :
     m_action_box(std::make_unique<ActionBox>(this)),
     m_image_viewer(std::make_unique<ImageViewer>(this)),
 
-    m_weighting(0) {
+    m_weighting(0),
+    m_camera_index(0),
+    m_effect_index(0) {
 
     m_ui->setupUi(this);
 
@@ -145,6 +155,7 @@ CameraDisplay::CameraDisplay(QWidget *parent) :
     connect(m_ui->weight_selector, qol<int>::of(&QSpinBox::valueChanged), this, &CameraDisplay::weighting_changed);
     connect(m_ui->picture_button, &QPushButton::clicked, this, &CameraDisplay::take_screen_shot);
     connect(m_ui->record_button, &QPushButton::clicked, this, &CameraDisplay::toggle_record);
+    connect(m_ui->step_button, &QPushButton::clicked, this, &CameraDisplay::step_replay);
     connect(m_ui->show_grid_button, &QPushButton::clicked, this, &CameraDisplay::show_grid_button_pushed);
     connect(m_ui->hide_grid_button, &QPushButton::clicked, this, &CameraDisplay::hide_grid_button_pushed);
     connect(m_ui->clear_grid_button, &QPushButton::clicked, this, &CameraDisplay::clear_grid);
@@ -190,16 +201,88 @@ void CameraDisplay::camera_box_changed(int camera) {
     if (camera < cameras.size()) {
         QCameraInfo info = cameras[camera];
         int camera_index = get_camera_index(info);
+        m_ui->step_button->setEnabled(false);
         Q_EMIT camera_changed(camera_index);
+    } else if (camera > cameras.size()) {
+        // Replay entry comes after the simulated camera
+        if (!select_replay()) {
+            // The previous camera is still running
+            QSignalBlocker blocker(m_ui->camera_box);
+            m_ui->camera_box->setCurrentIndex(m_camera_index);
+            return;
+        }
     } else {
         // Emit fake camera if the index is out of range
+        m_ui->step_button->setEnabled(false);
         Q_EMIT camera_changed(FakeCamera::FAKE_CAMERA);
     }
+    m_camera_index = camera;
+}
+
+bool CameraDisplay::select_replay() {
+    QString file = QFileDialog::getOpenFileName(
+        this, "Open Recording", QDir::currentPath(), "Recordings (*.avi *.mraw)");
+    if (file.isEmpty()) { return false; }
+    // Item order matches ReplayCamera::Mode
+    QStringList modes{"Real Time", "Max Speed", "Step"};
+    bool ok = false;
+    QString mode = QInputDialog::getItem(this, "Replay", "Playback mode:", modes, 0, false, &ok);
+    if (!ok) { return false; }
+    int replay_mode = modes.indexOf(mode);
+    m_ui->step_button->setEnabled(replay_mode == ReplayCamera::STEP);
+    log() << "Replaying recording: " << file;
+    Q_EMIT replay_changed(file, replay_mode);
+    return true;
 }
 
 void CameraDisplay::effect_box_changed(int effect) {
-    // Grab the modifier corresponding to the effect index
-    std::shared_ptr<VideoModifier> modifier = VideoModifier::get_modifier(effect);
+    int type = m_ui->effect_box->itemData(effect).toInt();
+    if (type == VideoModifier::CHAIN) {
+        if (!select_chain()) {
+            // The previous modifier is still running
+            QSignalBlocker blocker(m_ui->effect_box);
+            m_ui->effect_box->setCurrentIndex(m_effect_index);
+            return;
+        }
+    } else {
+        // Grab the modifier corresponding to the effect index
+        emit_modifier(VideoModifier::get_modifier(type));
+    }
+    m_effect_index = effect;
+}
+
+bool CameraDisplay::select_chain() {
+    QDialog dialog(this);
+    dialog.setWindowTitle("Modifier Chain");
+    auto *list = new QListWidget(&dialog);
+    // List the single modifiers, which draw in list order
+    for (int i = 0; i < m_ui->effect_box->count(); ++i) {
+        int type = m_ui->effect_box->itemData(i).toInt();
+        if (type == VideoModifier::NONE || type == VideoModifier::CHAIN) { continue; }
+        auto *item = new QListWidgetItem(m_ui->effect_box->itemText(i), list);
+        item->setData(Qt::UserRole, type);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Unchecked);
+    }
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    auto *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(list);
+    layout->addWidget(buttons);
+    if (dialog.exec() != QDialog::Accepted) { return false; }
+    std::vector<int> modifiers;
+    for (int i = 0; i < list->count(); ++i) {
+        if (list->item(i)->checkState() == Qt::Checked) {
+            modifiers.push_back(list->item(i)->data(Qt::UserRole).toInt());
+        }
+    }
+    log() << "Running " << modifiers.size() << " modifiers";
+    emit_modifier(VideoModifier::get_modifier(modifiers));
+    return true;
+}
+
+void CameraDisplay::emit_modifier(const std::shared_ptr<VideoModifier> &modifier) {
     m_action_box->reset_actions();
     // Register actions of the modifier
     if (modifier) { modifier->register_actions(m_action_box.get()); }
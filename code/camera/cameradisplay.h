@@ -52,6 +52,14 @@ public:
      */
     Q_SLOT void camera_box_changed(int camera);
 
+    /**
+     * Ask the user for a recording and playback mode
+     * and start replaying it.
+     *
+     * @return false if the user cancelled
+     */
+    Q_SLOT bool select_replay();
+
     /**
      * Slot called when the selected video modifier is changed.
      *
@@ -59,6 +67,14 @@ public:
      */
     Q_SLOT void effect_box_changed(int effect);
 
+    /**
+     * Ask the user which modifiers to run together and
+     * emit a chain of them.
+     *
+     * @return false if the user cancelled
+     */
+    Q_SLOT bool select_chain();
+
     /**
      * This slot is called when the user clicks the screenshot
      * button. This method creates the FileDialog to get the
@@ -143,6 +159,19 @@ public:
      */
     Q_SIGNAL void camera_changed(int camera);
 
+    /**
+     * Signal fired when a recording has been selected for replay.
+     *
+     * @param file path to the recording
+     * @param mode one of ReplayCamera::Mode
+     */
+    Q_SIGNAL void replay_changed(const QString &file, int mode);
+
+    /**
+     * Signal fired to advance a replay in step mode by one frame.
+     */
+    Q_SIGNAL void step_replay();
+
     /**
      * Signal fired with a shared pointer to the newly
      * selected video modifier. The preprocessor grabs and
@@ -234,6 +263,13 @@ public:
     Q_SIGNAL void move_grid(double x, double y);
 
 private:
+    /**
+     * Register the actions of a new modifier and emit it.
+     *
+     * @param modifier the modifier, or nullptr for none
+     */
+    void emit_modifier(const std::shared_ptr<VideoModifier> &modifier);
+
     Ui::CameraDisplay *m_ui;
 
     /**
@@ -251,6 +287,13 @@ private:
      */
     int m_weighting;
 
+    /**
+     * Camera and modifier indices in effect, selected again
+     * when a replay or chain dialog is cancelled.
+     */
+    int m_camera_index;
+    int m_effect_index;
+
 };
 
 #endif //MINOTAUR_CPP_CAMERADISPLAY_H
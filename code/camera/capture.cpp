@@ -1,7 +1,10 @@
 #include <QBasicTimer>
+#include <QString>
 #include <QTimerEvent>
 
 #include "capture.h"
+#include "replaycamera.h"
+#include "../utility/logger.h"
 #include "../utility/utility.h"
 #include "../simulator/fakecamera.h"
 
@@ -11,9 +14,23 @@
  */
 static QBasicTimer s_capture_timer;
 
-Capture::Capture() = default;
+Capture::Capture() :
+    m_replay(nullptr),
+    m_seq(0),
+    m_empty_frames(0),
+    m_frame_interval(DEFAULT_FRAME_INTERVAL),
+    m_grabbing(false),
+    m_grab_pending(false),
+    m_device_width(0),
+    m_device_height(0),
+    m_device_fps(0),
+    m_blocking_grab(true) {}
+
+Capture::~Capture() = default;
 
 void Capture::start_capture(int cam) {
+    m_replay = nullptr;
+    m_empty_frames = 0;
     // Create the capture instance
     if (cam == FakeCamera::FAKE_CAMERA) {
         // Override capture instance with FakeCamera
@@ -21,17 +38,98 @@ void Capture::start_capture(int cam) {
         m_video_capture = std::make_unique<FakeCamera>();
     } else {
         m_video_capture = std::make_unique<cv::VideoCapture>(cam);
+        if (m_video_capture->isOpened()) { negotiate_device(); }
+        if (m_blocking_grab) {
+            begin_grab();
+            return;
+        }
     }
+    // Max at 30 frames per second by default
+    // Limit mainly applies to the FakeCamera so that
+    // Qt's event resources are clogged up
+    begin_capture(m_frame_interval);
+}
+
+void Capture::start_replay(const QString &filename, int mode) {
+    auto replay = std::make_unique<ReplayCamera>(filename, static_cast<ReplayCamera::Mode>(mode));
+    m_replay = replay.get();
+    m_empty_frames = 0;
+    m_video_capture = std::move(replay);
+    // The replay paces itself unless running at max speed
+    begin_capture(mode == ReplayCamera::MAX_SPEED ? 0 : REPLAY_POLL_INTERVAL);
+}
+
+void Capture::begin_capture(int interval) {
     if (m_video_capture->isOpened()) {
-        // Max at 30 frames per second
-        // Limit mainly applies to the FakeCamera so that
-        // Qt's event resources are clogged up
-        s_capture_timer.start(33, this);
+        s_capture_timer.start(interval, this);
         Q_EMIT capture_started();
     }
 }
 
+void Capture::begin_grab() {
+    if (!m_video_capture->isOpened()) { return; }
+    m_grabbing = true;
+    // A grab still posted from a previous capture carries on the loop
+    if (!m_grab_pending) {
+        m_grab_pending = true;
+        QMetaObject::invokeMethod(this, "grab_frame", Qt::QueuedConnection);
+    }
+    Q_EMIT capture_started();
+}
+
+void Capture::grab_frame() {
+    m_grab_pending = false;
+    if (!m_grabbing) { return; }
+    // Blocks until the camera delivers the next frame
+    cv::UMat frame;
+    if (!m_video_capture->grab() || !m_video_capture->retrieve(frame) || frame.empty()) {
+        if (empty_frame()) { return; }
+    } else {
+        m_empty_frames = 0;
+        Q_EMIT frame_ready(frame, FrameInfo(++m_seq, pipeline_clock::now()));
+    }
+    m_grab_pending = true;
+    QMetaObject::invokeMethod(this, "grab_frame", Qt::QueuedConnection);
+}
+
+void Capture::negotiate_device() {
+    cv::VideoCapture &device = *m_video_capture;
+    // Only buffer a single frame so that each grab returns the newest one,
+    // where the backend supports it
+    device.set(cv::CAP_PROP_BUFFERSIZE, 1);
+    if (m_device_width > 0 && m_device_height > 0) {
+        device.set(cv::CAP_PROP_FRAME_WIDTH, m_device_width);
+        device.set(cv::CAP_PROP_FRAME_HEIGHT, m_device_height);
+    }
+    if (m_device_fps > 0) {
+        device.set(cv::CAP_PROP_FPS, m_device_fps);
+    }
+    // The device picks the closest mode it supports
+    log() << "Camera running at "
+          << device.get(cv::CAP_PROP_FRAME_WIDTH) << "x"
+          << device.get(cv::CAP_PROP_FRAME_HEIGHT) << " and "
+          << device.get(cv::CAP_PROP_FPS) << " fps";
+}
+
+bool Capture::empty_frame() {
+    // End of the recording, or the camera was disconnected
+    if (m_replay || !m_video_capture->isOpened() || ++m_empty_frames >= MAX_EMPTY_FRAMES) {
+        stop_capture();
+        return true;
+    }
+    // Skip a transient empty grab
+    return false;
+}
+
+void Capture::configure_device(int width, int height, int fps, bool blocking_grab) {
+    m_device_width = width;
+    m_device_height = height;
+    m_device_fps = fps;
+    m_blocking_grab = blocking_grab;
+}
+
 void Capture::stop_capture() {
+    m_grabbing = false;
     s_capture_timer.stop();
     // Release the video capture resources
     if (m_video_capture && m_video_capture->isOpened()) {
@@ -46,14 +144,39 @@ void Capture::change_camera(int camera) {
     start_capture(camera);
 }
 
+void Capture::change_replay(const QString &filename, int mode) {
+    stop_capture();
+    start_replay(filename, mode);
+}
+
+void Capture::step_replay() {
+    if (m_replay) { m_replay->step(); }
+}
+
+void Capture::set_frame_interval(int msec) {
+    m_frame_interval = msec < 0 ? 0 : msec;
+    if (s_capture_timer.isActive() && !m_replay) {
+        s_capture_timer.start(m_frame_interval, this);
+    }
+}
+
 void Capture::timerEvent(QTimerEvent *ev) {
     if (ev->timerId() != s_capture_timer.timerId()) {
         return;
     }
+    // Replays only produce frames when they are due
+    if (m_replay && !m_replay->frame_due()) {
+        return;
+    }
     // Grab the frame from the video capture and emit
     cv::UMat frame;
     *m_video_capture >> frame;
-    Q_EMIT frame_ready(frame);
+    if (frame.empty()) {
+        empty_frame();
+        return;
+    }
+    m_empty_frames = 0;
+    Q_EMIT frame_ready(frame, FrameInfo(++m_seq, pipeline_clock::now()));
 }
 
 int Capture::capture_width() const {
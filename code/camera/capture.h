@@ -2,26 +2,50 @@
 #define MINOTAUR_CPP_CAPTURE_H
 
 #include <QObject>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 
+#include "frameinfo.h"
+
 // OpenCV forward declarations
 namespace cv {
     class UMat;
     class VideoCapture;
 }
+class ReplayCamera;
 
 /**
  * This object is the beginning of the image pipeline and
  * is responsible for managing the OpenCV Video Capture
  * object that polls frames from the active camera. These frames
  * are emitted to the preprocessor.
+ *
+ * Real cameras are read in a blocking grab loop by default, so that
+ * each frame is emitted as soon as the device delivers it, at whatever
+ * rate the device runs. Each grab is posted as its own event so that
+ * the capture thread still handles other slots between frames. The
+ * FakeCamera, replays, and cameras with blocking grab disabled are
+ * polled with a timer instead.
  */
 class Capture : public QObject {
     Q_OBJECT
 
 public:
+    enum {
+        // Default time in milliseconds between frames, about 30 fps
+        DEFAULT_FRAME_INTERVAL = 33,
+        // Time in milliseconds between checks for a due replay frame
+        REPLAY_POLL_INTERVAL = 1,
+        // Consecutive empty frames after which a live camera is
+        // considered disconnected
+        MAX_EMPTY_FRAMES = 30
+    };
+
     Capture();
 
+    ~Capture() override;
+
     int capture_width() const;
 
     int capture_height() const;
@@ -32,23 +56,131 @@ public:
 
     /**
      * Signal emitted when a frame has been received
-     * by the Capture.
+     * by the Capture, with its sequence number and timestamp.
      */
-    Q_SIGNAL void frame_ready(const cv::UMat &);
+    Q_SIGNAL void frame_ready(const cv::UMat &, const FrameInfo &);
 
     Q_SLOT void start_capture(int cam);
 
+    /**
+     * Start replaying a recorded video with a ReplayCamera.
+     * Capture stops when the end of the recording is reached.
+     *
+     * @param filename path to the recording
+     * @param mode     one of ReplayCamera::Mode
+     */
+    Q_SLOT void start_replay(const QString &filename, int mode);
+
     Q_SLOT void stop_capture();
 
     Q_SLOT void change_camera(int camera);
 
+    /**
+     * Set the settings requested from real cameras when they are started.
+     * Safe to call from any thread.
+     *
+     * @param width         requested frame width, or 0 for the device default
+     * @param height        requested frame height, or 0 for the device default
+     * @param fps           requested frame rate, or 0 for the device default
+     * @param blocking_grab whether to read frames in a blocking grab loop
+     */
+    Q_SLOT void configure_device(int width, int height, int fps, bool blocking_grab);
+
+    /**
+     * Halt the current capture and start replaying a recording.
+     *
+     * @param filename path to the recording
+     * @param mode     one of ReplayCamera::Mode
+     */
+    Q_SLOT void change_replay(const QString &filename, int mode);
+
+    /**
+     * Advance a replay in step mode by one frame.
+     */
+    Q_SLOT void step_replay();
+
+    /**
+     * Set the time between frames. An interval of zero polls
+     * frames as fast as the capture thread event loop allows.
+     *
+     * @param msec interval in milliseconds
+     */
+    Q_SLOT void set_frame_interval(int msec);
+
 private:
     void timerEvent(QTimerEvent *ev) override;
 
+    /**
+     * Start the capture timer if the video capture was opened.
+     *
+     * @param interval time in milliseconds between frames
+     */
+    void begin_capture(int interval);
+
+    /**
+     * Start the blocking grab loop if the video capture was opened.
+     */
+    void begin_grab();
+
+    /**
+     * Block until the camera delivers a frame, emit it, and post
+     * the next grab.
+     */
+    Q_SLOT void grab_frame();
+
+    /**
+     * Request the configured resolution and frame rate from the
+     * camera and log what it settled on.
+     */
+    void negotiate_device();
+
+    /**
+     * Handle an empty frame. Replays have ended, while a live camera
+     * is only stopped if it is closed or keeps delivering empty frames.
+     *
+     * @return whether capture was stopped
+     */
+    bool empty_frame();
+
     /**
      * Video Capture instance that produces images.
      */
     std::unique_ptr<cv::VideoCapture> m_video_capture;
+    /**
+     * The video capture if it is a ReplayCamera, otherwise null.
+     */
+    ReplayCamera *m_replay;
+
+    /**
+     * Sequence number of the last emitted frame.
+     */
+    std::uint64_t m_seq;
+    /**
+     * Number of consecutive empty frames.
+     */
+    int m_empty_frames;
+
+    /**
+     * Time in milliseconds between frames.
+     */
+    int m_frame_interval;
+
+    /**
+     * Whether the grab loop is running.
+     */
+    bool m_grabbing;
+    /**
+     * Whether a grab_frame() call has been posted and not yet run.
+     */
+    bool m_grab_pending;
+
+    /**
+     * Requested camera settings.
+     */
+    std::atomic<int> m_device_width;
+    std::atomic<int> m_device_height;
+    std::atomic<int> m_device_fps;
+    std::atomic<bool> m_blocking_grab;
 };
 
 #endif //MINOTAUR_CPP_CAPTURE_H
@@ -1,40 +1,61 @@
 #include <opencv2/imgproc.hpp>
 #include "converter.h"
+#include "framepool.h"
 #include "imageviewer.h"
-
-static void umat_delete(void *mat)
-{ delete static_cast<cv::UMat *>(mat); }
+#include "pipelinestats.h"
+#include "../utility/utility.h"
 
 Converter::Converter(ImageViewer *image_viewer) :
+    m_frames(0),
+    m_scale(1.0),
+    m_image_viewer(image_viewer),
+    m_width(0),
+    m_height(0),
+    m_pool(std::make_unique<FramePool>()) {}
+
+Converter::Converter(int width, int height) :
+    m_frames(0),
     m_scale(1.0),
-    m_image_viewer(image_viewer) {}
+    m_image_viewer(nullptr),
+    m_width(width),
+    m_height(height),
+    m_pool(std::make_unique<FramePool>()) {}
 
-void Converter::process_frame(const cv::UMat &frame) {
+Converter::~Converter() = default;
+
+void Converter::process_frame(const cv::UMat &frame, const FrameInfo &info) {
+    pipeline_clock::time_point start = pipeline_clock::now();
     // Calculate the required scale
+    int width = m_image_viewer ? m_image_viewer->width() : m_width;
+    int height = m_image_viewer ? m_image_viewer->height() : m_height;
     m_scale = std::min(
-        static_cast<double>(m_image_viewer->width()) / frame.size().width,
-        static_cast<double>(m_image_viewer->height()) / frame.size().height
+        static_cast<double>(width) / frame.size().width,
+        static_cast<double>(height) / frame.size().height
     );
-    cv::UMat dst;
-    // Scale the image into dst
-    cv::resize(frame, dst, cv::Size(), m_scale, m_scale, cv::INTER_LINEAR);
-    // Convert to QImage
-    const QImage image(
-        dst.getMat(1).data, dst.cols, dst.rows, static_cast<int>(dst.step),
-        QImage::Format_RGB888, &umat_delete, new cv::UMat(dst)
+    cv::Size size(
+        cvRound(frame.size().width * m_scale),
+        cvRound(frame.size().height * m_scale)
     );
+    // Scale the image straight into a pooled buffer
+    FramePool::Buffer *buffer = m_pool->acquire(size, CV_8UC3);
+    cv::resize(frame, FramePool::mat(buffer), size, 0, 0, cv::INTER_LINEAR);
+    // Convert to QImage, which returns the buffer to the pool when released
+    const QImage image = FramePool::wrap(buffer, QImage::Format_RGB888);
     // Increment number of frames processed
     ++m_frames;
+    PipelineStats::get().record_since(PipelineStats::CONVERT, start);
     // Emit the image
-    Q_EMIT image_ready(image);
+    Q_EMIT image_ready(image, info);
 }
 
 int Converter::get_and_reset_frames() {
-    int frames = m_frames;
-    m_frames = 0;
-    return frames;
+    return m_frames.exchange(0);
 }
 
 double Converter::get_previous_scale() const {
     return m_scale;
 }
+
+std::size_t Converter::buffers_allocated() const {
+    return m_pool->allocated();
+}
@@ -2,8 +2,13 @@
 #define MINOTAUR_CPP_CONVERTER_H
 
 #include <QObject>
+#include <atomic>
+#include <memory>
+
+#include "frameinfo.h"
 
 // Forward declarations
+class FramePool;
 class ImageViewer;
 namespace cv {
     class UMat;
@@ -13,6 +18,9 @@ namespace cv {
  * This object is responsible for taking processed video frames
  * from the image pipeline and convert them to QImage for display
  * on the ImageViewer.
+ *
+ * Frames are scaled directly into recycled buffers from a FramePool,
+ * which the emitted QImage wraps without copying.
  */
 class Converter : public QObject {
 Q_OBJECT
@@ -20,19 +28,32 @@ Q_OBJECT
 public:
     explicit Converter(ImageViewer *image_viewer);
 
+    /**
+     * Create a Converter that scales frames to fit a fixed size
+     * instead of an ImageViewer, for use without a display.
+     *
+     * @param width  target width
+     * @param height target height
+     */
+    Converter(int width, int height);
+
+    ~Converter() override;
+
     /**
      * Signal emitted when a QImage has been produced.
      *
-     * @param img converted QImage
+     * @param img  converted QImage
+     * @param info frame sequence number and timestamp
      */
-    Q_SIGNAL void image_ready(const QImage &img);
+    Q_SIGNAL void image_ready(const QImage &img, const FrameInfo &info);
 
     /**
      * Slot to receive a processed frame to convert.
      *
      * @param frame processed frame to convert
+     * @param info  frame sequence number and timestamp
      */
-    Q_SLOT void process_frame(const cv::UMat &frame);
+    Q_SLOT void process_frame(const cv::UMat &frame, const FrameInfo &info = FrameInfo());
 
     /**
      * Grab the number of frames processed since the last time
@@ -50,11 +71,16 @@ public:
      */
     double get_previous_scale() const;
 
+    /**
+     * @return number of display buffers allocated so far
+     */
+    std::size_t buffers_allocated() const;
+
 private:
     /**
      * Number of frames processed since last call to get_and_reset_frames().
      */
-    int m_frames;
+    std::atomic<int> m_frames;
     /**
      * Previous scale on Mat to QImage.
      */
@@ -63,6 +89,15 @@ private:
      * Reference to ImageViewer used to poll width and height for scaling.
      */
     ImageViewer *m_image_viewer;
+    /**
+     * Target dimensions used when there is no ImageViewer.
+     */
+    int m_width;
+    int m_height;
+    /**
+     * Recycled display-sized buffers wrapped by the emitted images.
+     */
+    std::unique_ptr<FramePool> m_pool;
 };
 
 
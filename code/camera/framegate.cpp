@@ -0,0 +1,37 @@
+#include <opencv2/imgproc.hpp>
+
+#include "framegate.h"
+
+#include <utility>
+
+FrameGate::FrameGate() :
+    m_reused(0) {}
+
+bool FrameGate::changed(const cv::UMat &frame, double threshold, int max_reuse) {
+    if (threshold <= 0) {
+        reset();
+        return true;
+    }
+    cv::UMat gray = frame;
+    if (frame.channels() == 3) { cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY); }
+    // Area interpolation averages each block
+    cv::resize(gray, m_signature, cv::Size(SIGNATURE_WIDTH, SIGNATURE_HEIGHT), 0, 0, cv::INTER_AREA);
+    m_signature.convertTo(m_signature, CV_32F);
+    if (!m_reference.empty() && m_reused < max_reuse) {
+        cv::absdiff(m_signature, m_reference, m_diff);
+        double max_diff = 0;
+        cv::minMaxLoc(m_diff, nullptr, &max_diff);
+        if (max_diff <= threshold) {
+            ++m_reused;
+            return false;
+        }
+    }
+    std::swap(m_reference, m_signature);
+    m_reused = 0;
+    return true;
+}
+
+void FrameGate::reset() {
+    m_reference.release();
+    m_reused = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef MINOTAUR_CPP_FRAMEGATE_H
+#define MINOTAUR_CPP_FRAMEGATE_H
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * Decides whether a frame differs enough from the last analyzed frame
+ * to be analyzed again, so that analysis may be skipped while nothing
+ * on the field moves.
+ *
+ * A frame's signature is its grayscale mean over each block of a coarse
+ * grid. The frame is unchanged when no block mean differs from that of
+ * the last analyzed frame by more than the threshold. Comparing against
+ * the last analyzed frame, rather than the previous frame, keeps slow
+ * changes from slipping through a frame at a time.
+ */
+class FrameGate {
+public:
+    enum {
+        // Signature grid, each block is 20x20 pixels of a 640x480 frame
+        SIGNATURE_WIDTH = 32,
+        SIGNATURE_HEIGHT = 24
+    };
+
+    FrameGate();
+
+    /**
+     * Check a frame, and make it the reference if it is to be analyzed.
+     *
+     * @param frame     full frame, in BGR or grayscale
+     * @param threshold largest block mean difference in gray levels of an
+     *                  unchanged frame, or 0 to analyze every frame
+     * @param max_reuse most consecutive frames to skip before analyzing
+     *                  one anyway
+     * @return whether the frame should be analyzed
+     */
+    bool changed(const cv::UMat &frame, double threshold, int max_reuse);
+
+    /**
+     * Analyze the next frame, such as when the analysis itself changes.
+     */
+    void reset();
+
+private:
+    cv::Mat m_reference;
+    cv::Mat m_signature;
+    cv::Mat m_diff;
+    int m_reused;
+};
+
+#endif //MINOTAUR_CPP_FRAMEGATE_H
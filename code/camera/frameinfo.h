@@ -0,0 +1,46 @@
+#ifndef MINOTAUR_CPP_FRAMEINFO_H
+#define MINOTAUR_CPP_FRAMEINFO_H
+
+#include <chrono>
+#include <cstdint>
+
+#include <QMetaType>
+
+/**
+ * Monotonic clock used to timestamp frames in the image pipeline.
+ */
+typedef std::chrono::steady_clock pipeline_clock;
+
+/**
+ * Metadata that travels alongside each frame through the image
+ * pipeline, from the Capture to the ImageViewer.
+ */
+struct FrameInfo {
+    FrameInfo() :
+        seq(0),
+        reused(false) {}
+
+    FrameInfo(std::uint64_t t_seq, pipeline_clock::time_point t_captured) :
+        seq(t_seq),
+        captured(t_captured),
+        reused(false) {}
+
+    /**
+     * Sequence number assigned by the Capture, starting at 1.
+     * A value of 0 means the frame was not stamped.
+     */
+    std::uint64_t seq;
+    /**
+     * Time at which the frame left the Capture.
+     */
+    pipeline_clock::time_point captured;
+    /**
+     * Whether the frame was not analyzed because it was unchanged, and
+     * the results drawn onto it are those of an earlier frame.
+     */
+    bool reused;
+};
+
+Q_DECLARE_METATYPE(FrameInfo);
+
+#endif //MINOTAUR_CPP_FRAMEINFO_H
@@ -0,0 +1,93 @@
+#include <opencv2/core.hpp>
+#include <QMutex>
+#include <QMutexLocker>
+#include <vector>
+
+#include "framepool.h"
+
+struct FramePool::State {
+    explicit State(std::size_t t_max_free) :
+        max_free(t_max_free),
+        allocated(0),
+        alive(true) {
+        free.reserve(max_free);
+    }
+
+    QMutex mutex;
+    std::vector<Buffer *> free;
+    std::size_t max_free;
+    std::size_t allocated;
+    bool alive;
+};
+
+struct FramePool::Buffer {
+    explicit Buffer(std::shared_ptr<State> t_state) :
+        state(std::move(t_state)) {}
+
+    cv::Mat mat;
+    std::shared_ptr<State> state;
+};
+
+FramePool::FramePool(std::size_t max_free) :
+    m_state(std::make_shared<State>(max_free)) {}
+
+FramePool::~FramePool() {
+    std::vector<Buffer *> idle;
+    {
+        QMutexLocker lock(&m_state->mutex);
+        m_state->alive = false;
+        idle.swap(m_state->free);
+    }
+    for (Buffer *buffer : idle) { delete buffer; }
+}
+
+FramePool::Buffer *FramePool::acquire(const cv::Size &size, int type) {
+    Buffer *buffer = nullptr;
+    {
+        QMutexLocker lock(&m_state->mutex);
+        if (!m_state->free.empty()) {
+            buffer = m_state->free.back();
+            m_state->free.pop_back();
+        } else {
+            ++m_state->allocated;
+        }
+    }
+    if (!buffer) { buffer = new Buffer(m_state); }
+    buffer->mat.create(size, type);
+    return buffer;
+}
+
+cv::Mat &FramePool::mat(Buffer *buffer) {
+    return buffer->mat;
+}
+
+QImage FramePool::wrap(Buffer *buffer, QImage::Format format) {
+    const cv::Mat &mat = buffer->mat;
+    return QImage(
+        mat.data, mat.cols, mat.rows, static_cast<int>(mat.step),
+        format, &FramePool::image_cleanup, buffer
+    );
+}
+
+void FramePool::release(Buffer *buffer) {
+    if (!buffer) { return; }
+    // Hold onto the state in case this buffer is its last owner
+    std::shared_ptr<State> state = buffer->state;
+    {
+        QMutexLocker lock(&state->mutex);
+        if (state->alive && state->free.size() < state->max_free) {
+            state->free.push_back(buffer);
+            return;
+        }
+    }
+    delete buffer;
+}
+
+void FramePool::image_cleanup(void *cookie) {
+    release(static_cast<Buffer *>(cookie));
+}
+
+std::size_t FramePool::allocated() const {
+    QMutexLocker lock(&m_state->mutex);
+    return m_state->allocated;
+}
@@ -0,0 +1,99 @@
+#ifndef MINOTAUR_CPP_FRAMEPOOL_H
+#define MINOTAUR_CPP_FRAMEPOOL_H
+
+#include <QImage>
+#include <memory>
+
+// OpenCV forward declarations
+namespace cv {
+    class Mat;
+    template<typename _Tp> class Size_;
+    typedef Size_<int> Size;
+}
+
+/**
+ * A pool of recycled image buffers that QImage can wrap directly.
+ *
+ * A buffer is acquired, filled, and handed to wrap(), which produces a
+ * QImage sharing the buffer memory. When the last copy of that QImage is
+ * destroyed, on whichever thread, the buffer is returned to the pool
+ * instead of being freed. Once the pool has warmed up, producing an
+ * image allocates nothing.
+ *
+ * Buffers still referenced by images when the pool is destroyed are
+ * freed when those images are released.
+ */
+class FramePool {
+public:
+    enum {
+        // Maximum number of idle buffers kept for reuse
+        DEFAULT_MAX_FREE = 4
+    };
+
+    struct Buffer;
+
+    explicit FramePool(std::size_t max_free = DEFAULT_MAX_FREE);
+
+    ~FramePool();
+
+    /**
+     * Take a buffer from the pool, or allocate one if none are idle.
+     * The buffer matrix is (re)created with the requested size and type,
+     * which only allocates if it differs from the previous use.
+     *
+     * @param size buffer dimensions
+     * @param type OpenCV matrix type
+     * @return the buffer, owned by the caller until wrapped or returned
+     */
+    Buffer *acquire(const cv::Size &size, int type);
+
+    /**
+     * @param buffer an acquired buffer
+     * @return the buffer's matrix, to be filled by the caller
+     */
+    static cv::Mat &mat(Buffer *buffer);
+
+    /**
+     * Wrap the buffer in a QImage. Ownership of the buffer passes to the
+     * image, and it returns to the pool when the image is released.
+     *
+     * @param buffer an acquired buffer
+     * @param format the QImage format matching the buffer type
+     * @return image sharing the buffer memory
+     */
+    static QImage wrap(Buffer *buffer, QImage::Format format);
+
+    /**
+     * Return a buffer to the pool without wrapping it.
+     *
+     * @param buffer an acquired buffer
+     */
+    static void release(Buffer *buffer);
+
+    /**
+     * @return number of buffers allocated over the lifetime of the pool
+     */
+    std::size_t allocated() const;
+
+    // Disable copy constructor and assignment
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+private:
+    struct State;
+
+    /**
+     * QImage cleanup function.
+     *
+     * @param cookie the wrapped buffer
+     */
+    static void image_cleanup(void *cookie);
+
+    /**
+     * State shared with outstanding buffers so that they can find
+     * their way back, or know that the pool is gone.
+     */
+    std::shared_ptr<State> m_state;
+};
+
+#endif //MINOTAUR_CPP_FRAMEPOOL_H
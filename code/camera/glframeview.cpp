@@ -0,0 +1,302 @@
+#include "glframeview.h"
+#include "../utility/utility.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QMatrix4x4>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    const char *const FRAME_VERTEX_SHADER =
+        "attribute highp vec2 position;\n"
+        "uniform highp mat4 matrix;\n"
+        "varying highp vec2 tex_coord;\n"
+        "void main() {\n"
+        "    tex_coord = position;\n"
+        "    gl_Position = matrix * vec4(position, 0.0, 1.0);\n"
+        "}\n";
+
+    const char *const FRAME_FRAGMENT_SHADER =
+        "uniform sampler2D frame;\n"
+        "varying highp vec2 tex_coord;\n"
+        "void main() {\n"
+        "    gl_FragColor = texture2D(frame, tex_coord);\n"
+        "}\n";
+
+    const char *const OVERLAY_VERTEX_SHADER =
+        "attribute highp vec2 position;\n"
+        "attribute lowp vec4 color;\n"
+        "uniform highp mat4 matrix;\n"
+        "varying lowp vec4 v_color;\n"
+        "void main() {\n"
+        "    v_color = color;\n"
+        "    gl_Position = matrix * vec4(position, 0.0, 1.0);\n"
+        "}\n";
+
+    const char *const OVERLAY_FRAGMENT_SHADER =
+        "varying lowp vec4 v_color;\n"
+        "void main() {\n"
+        "    gl_FragColor = v_color;\n"
+        "}\n";
+
+    // Unit square drawn as a triangle strip, doubling as texture coordinates
+    const GLfloat QUAD[] = {0, 0, 1, 0, 0, 1, 1, 1};
+
+    // Floats per overlay vertex
+    const int OVERLAY_STRIDE = 6;
+    // Node discs and path lines, as QPainter drew them
+    const float NODE_RADIUS = 4.0f;
+    const int NODE_SEGMENTS = 12;
+    const float LINE_HALF_WIDTH = 1.0f;
+    // Dash, gap, dot, gap lengths of a dash-dot line of width 2
+    const float DASH_PATTERN[] = {8.0f, 4.0f, 2.0f, 4.0f};
+    const int DASH_PATTERN_SIZE = 4;
+
+    struct rgba {
+        GLfloat r, g, b, a;
+    };
+
+    const rgba RED = {1, 0, 0, 1};
+    const rgba GREEN = {0, 1, 0, 1};
+    const rgba BLUE = {0, 0, 1, 1};
+}
+
+static void add_vertex(std::vector<GLfloat> &out, float x, float y, const rgba &c) {
+    out.insert(out.end(), {x, y, c.r, c.g, c.b, c.a});
+}
+
+static void add_disc(std::vector<GLfloat> &out, const QPointF &center, const rgba &c) {
+    auto x = static_cast<float>(center.x());
+    auto y = static_cast<float>(center.y());
+    const float step = 2.0f * static_cast<float>(M_PI) / NODE_SEGMENTS;
+    for (int i = 0; i < NODE_SEGMENTS; ++i) {
+        add_vertex(out, x, y, c);
+        add_vertex(out, x + NODE_RADIUS * std::cos(i * step), y + NODE_RADIUS * std::sin(i * step), c);
+        add_vertex(out, x + NODE_RADIUS * std::cos((i + 1) * step), y + NODE_RADIUS * std::sin((i + 1) * step), c);
+    }
+}
+
+static void add_dashed_line(std::vector<GLfloat> &out, const QPointF &p0, const QPointF &p1, const rgba &c) {
+    auto dx = static_cast<float>(p1.x() - p0.x());
+    auto dy = static_cast<float>(p1.y() - p0.y());
+    float length = std::sqrt(dx * dx + dy * dy);
+    if (length <= 0) { return; }
+    float ux = dx / length;
+    float uy = dy / length;
+    // Offset of each edge of the line from its center
+    float nx = -uy * LINE_HALF_WIDTH;
+    float ny = ux * LINE_HALF_WIDTH;
+    auto x0 = static_cast<float>(p0.x());
+    auto y0 = static_cast<float>(p0.y());
+    float t = 0;
+    for (int i = 0; t < length; i = (i + 1) % DASH_PATTERN_SIZE) {
+        float end = std::min(t + DASH_PATTERN[i], length);
+        // Even pattern entries are drawn, odd ones are gaps
+        if (i % 2 == 0) {
+            float ax = x0 + ux * t;
+            float ay = y0 + uy * t;
+            float bx = x0 + ux * end;
+            float by = y0 + uy * end;
+            add_vertex(out, ax + nx, ay + ny, c);
+            add_vertex(out, ax - nx, ay - ny, c);
+            add_vertex(out, bx + nx, by + ny, c);
+            add_vertex(out, bx + nx, by + ny, c);
+            add_vertex(out, ax - nx, ay - ny, c);
+            add_vertex(out, bx - nx, by - ny, c);
+        }
+        t = end;
+    }
+}
+
+GLFrameView::GLFrameView(QWidget *parent) :
+    QOpenGLWidget(parent),
+    m_image_pending(false),
+    m_pixel_buffers{QOpenGLBuffer(QOpenGLBuffer::PixelUnpackBuffer),
+                    QOpenGLBuffer(QOpenGLBuffer::PixelUnpackBuffer)},
+    m_next_buffer(0),
+    m_use_pixel_buffers(false),
+    m_quad(QOpenGLBuffer::VertexBuffer),
+    m_overlay_pending(false),
+    m_overlay_buffer(QOpenGLBuffer::VertexBuffer),
+    m_overlay_vertices(0) {}
+
+GLFrameView::~GLFrameView() {
+    release_gl();
+}
+
+void GLFrameView::set_image(const QImage &img) {
+    m_image = img;
+    m_image_pending = true;
+    update();
+}
+
+void GLFrameView::set_path(const std::vector<QPointF> &nodes) {
+    m_overlay.clear();
+    for (std::size_t i = 1; i < nodes.size(); ++i) {
+        add_dashed_line(m_overlay, nodes[i - 1], nodes[i], GREEN);
+    }
+    // Color based on start and end
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        const rgba &color = i == 0 ? RED : i + 1 == nodes.size() ? BLUE : GREEN;
+        add_disc(m_overlay, nodes[i], color);
+    }
+    m_overlay_pending = true;
+    update();
+}
+
+void GLFrameView::initializeGL() {
+    initializeOpenGLFunctions();
+    // Resources belong to the context, which may be replaced when reparented
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &GLFrameView::release_gl,
+            Qt::UniqueConnection);
+
+    m_frame_program = std::make_unique<QOpenGLShaderProgram>();
+    m_frame_program->addShaderFromSourceCode(QOpenGLShader::Vertex, FRAME_VERTEX_SHADER);
+    m_frame_program->addShaderFromSourceCode(QOpenGLShader::Fragment, FRAME_FRAGMENT_SHADER);
+    m_frame_program->bindAttributeLocation("position", 0);
+    m_frame_program->link();
+
+    m_overlay_program = std::make_unique<QOpenGLShaderProgram>();
+    m_overlay_program->addShaderFromSourceCode(QOpenGLShader::Vertex, OVERLAY_VERTEX_SHADER);
+    m_overlay_program->addShaderFromSourceCode(QOpenGLShader::Fragment, OVERLAY_FRAGMENT_SHADER);
+    m_overlay_program->bindAttributeLocation("position", 0);
+    m_overlay_program->bindAttributeLocation("color", 1);
+    m_overlay_program->link();
+
+    m_quad.create();
+    m_quad.bind();
+    m_quad.allocate(QUAD, sizeof(QUAD));
+    m_quad.release();
+
+    m_overlay_buffer.create();
+    m_overlay_buffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+
+    // Pixel buffers need desktop OpenGL or OpenGL ES 3
+    QOpenGLContext *ctx = context();
+    m_use_pixel_buffers = !ctx->isOpenGLES() || ctx->format().majorVersion() >= 3;
+    if (m_use_pixel_buffers) {
+        for (QOpenGLBuffer &buffer : m_pixel_buffers) {
+            buffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+            m_use_pixel_buffers = m_use_pixel_buffers && buffer.create();
+        }
+    }
+    glClearColor(0, 0, 0, 1);
+    // The frame may be uploaded again into the new context
+    m_image_pending = !m_image.isNull();
+    m_overlay_pending = true;
+}
+
+void GLFrameView::resizeGL(int, int) {}
+
+void GLFrameView::upload_frame() {
+    int width = m_image.width();
+    int height = m_image.height();
+    if (!m_texture || m_texture->width() != width || m_texture->height() != height) {
+        m_texture = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2D);
+        m_texture->setSize(width, height);
+        m_texture->setFormat(QOpenGLTexture::RGB8_UNorm);
+        m_texture->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+        m_texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+        m_texture->allocateStorage(QOpenGLTexture::RGB, QOpenGLTexture::UInt8);
+    }
+    // Pooled frames wrap matrices with tightly packed rows, while images
+    // allocated by Qt pad them to four bytes; unpack with whichever the
+    // image uses so the rows and the buffer size agree with it
+    const int stride = m_image.bytesPerLine();
+    const int size = stride * height;
+    const uchar *bits = m_image.constBits();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, stride % 4 == 0 ? 4 : stride % 2 == 0 ? 2 : 1);
+    m_texture->bind();
+    if (m_use_pixel_buffers) {
+        // Fill the buffer the last upload did not read from, then queue
+        // the upload from it; the call returns without waiting for the copy
+        QOpenGLBuffer &buffer = m_pixel_buffers[m_next_buffer];
+        m_next_buffer = (m_next_buffer + 1) % PIXEL_BUFFERS;
+        buffer.bind();
+        if (buffer.size() != size) { buffer.allocate(size); }
+        void *mapped = buffer.mapRange(0, size, QOpenGLBuffer::RangeWrite | QOpenGLBuffer::RangeInvalidateBuffer);
+        if (mapped) {
+            std::memcpy(mapped, bits, static_cast<std::size_t>(size));
+            buffer.unmap();
+        } else {
+            buffer.write(0, bits, size);
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        buffer.release();
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, bits);
+    }
+    m_texture->release();
+    // The image is no longer needed and its buffer can be recycled
+    m_image = QImage();
+    m_image_pending = false;
+}
+
+void GLFrameView::upload_overlay() {
+    m_overlay_buffer.bind();
+    m_overlay_buffer.allocate(m_overlay.data(), static_cast<int>(m_overlay.size() * sizeof(GLfloat)));
+    m_overlay_buffer.release();
+    m_overlay_vertices = static_cast<int>(m_overlay.size() / OVERLAY_STRIDE);
+    m_overlay_pending = false;
+}
+
+void GLFrameView::paintGL() {
+    pipeline_clock::time_point start = pipeline_clock::now();
+    if (m_image_pending) { upload_frame(); }
+    if (m_overlay_pending) { upload_overlay(); }
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Widget pixels with the origin at the top left
+    QMatrix4x4 projection;
+    projection.ortho(0, width(), height(), 0, -1, 1);
+
+    if (m_texture) {
+        QMatrix4x4 matrix = projection;
+        matrix.scale(m_texture->width(), m_texture->height());
+        m_frame_program->bind();
+        m_frame_program->setUniformValue("matrix", matrix);
+        m_frame_program->setUniformValue("frame", 0);
+        glActiveTexture(GL_TEXTURE0);
+        m_texture->bind();
+        m_quad.bind();
+        m_frame_program->enableAttributeArray(0);
+        m_frame_program->setAttributeBuffer(0, GL_FLOAT, 0, 2);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        m_frame_program->disableAttributeArray(0);
+        m_quad.release();
+        m_texture->release();
+        m_frame_program->release();
+    }
+
+    if (m_overlay_vertices > 0) {
+        const int stride = OVERLAY_STRIDE * sizeof(GLfloat);
+        m_overlay_program->bind();
+        m_overlay_program->setUniformValue("matrix", projection);
+        m_overlay_buffer.bind();
+        m_overlay_program->enableAttributeArray(0);
+        m_overlay_program->enableAttributeArray(1);
+        m_overlay_program->setAttributeBuffer(0, GL_FLOAT, 0, 2, stride);
+        m_overlay_program->setAttributeBuffer(1, GL_FLOAT, 2 * sizeof(GLfloat), 4, stride);
+        glDrawArrays(GL_TRIANGLES, 0, m_overlay_vertices);
+        m_overlay_program->disableAttributeArray(1);
+        m_overlay_program->disableAttributeArray(0);
+        m_overlay_buffer.release();
+        m_overlay_program->release();
+    }
+    Q_EMIT painted(start);
+}
+
+void GLFrameView::release_gl() {
+    if (!m_frame_program) { return; }
+    makeCurrent();
+    m_texture.reset();
+    for (QOpenGLBuffer &buffer : m_pixel_buffers) { buffer.destroy(); }
+    m_quad.destroy();
+    m_overlay_buffer.destroy();
+    m_frame_program.reset();
+    m_overlay_program.reset();
+    doneCurrent();
+}
@@ -0,0 +1,99 @@
+#ifndef MINOTAUR_CPP_GLFRAMEVIEW_H
+#define MINOTAUR_CPP_GLFRAMEVIEW_H
+
+#include <QImage>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLWidget>
+#include <memory>
+#include <vector>
+
+#include "frameinfo.h"
+
+// Forward declarations
+class QOpenGLShaderProgram;
+class QOpenGLTexture;
+
+/**
+ * OpenGL display of the camera frames and the path overlay, used by the
+ * ImageViewer in place of painting with QPainter on the GUI thread.
+ *
+ * Frames are streamed into a texture through two pixel buffers used in
+ * turn: each frame is copied into the buffer the GPU is not reading, and
+ * the texture upload from it is queued without waiting for the transfer.
+ * The overlay is tessellated into triangles once, when it is set, and
+ * kept in a vertex buffer, so a frame is drawn with two draw calls.
+ */
+class GLFrameView : public QOpenGLWidget, protected QOpenGLFunctions {
+Q_OBJECT
+
+public:
+    explicit GLFrameView(QWidget *parent = nullptr);
+
+    ~GLFrameView() override;
+
+    /**
+     * Display a frame. The image is shared, not copied, until it is
+     * uploaded on the next paint.
+     *
+     * @param img frame in Format_RGB888
+     */
+    void set_image(const QImage &img);
+
+    /**
+     * Replace the path overlay, which is tessellated immediately.
+     *
+     * @param nodes path nodes in widget pixels
+     */
+    void set_path(const std::vector<QPointF> &nodes);
+
+    /**
+     * Emitted after each paint with the time the paint started.
+     */
+    Q_SIGNAL void painted(pipeline_clock::time_point start);
+
+protected:
+    void initializeGL() override;
+
+    void resizeGL(int w, int h) override;
+
+    void paintGL() override;
+
+private:
+    enum {
+        PIXEL_BUFFERS = 2
+    };
+
+    /**
+     * Copy the pending frame into the next pixel buffer and upload
+     * it to the texture, reallocating the texture if the size changed.
+     */
+    void upload_frame();
+
+    void upload_overlay();
+
+    void release_gl();
+
+    QImage m_image;
+    bool m_image_pending;
+
+    QOpenGLBuffer m_pixel_buffers[PIXEL_BUFFERS];
+    int m_next_buffer;
+    // Whether the context supports pixel buffers
+    bool m_use_pixel_buffers;
+    std::unique_ptr<QOpenGLTexture> m_texture;
+
+    std::unique_ptr<QOpenGLShaderProgram> m_frame_program;
+    std::unique_ptr<QOpenGLShaderProgram> m_overlay_program;
+    QOpenGLBuffer m_quad;
+
+    /**
+     * Overlay triangles as interleaved x, y, r, g, b, a.
+     */
+    std::vector<GLfloat> m_overlay;
+    bool m_overlay_pending;
+    QOpenGLBuffer m_overlay_buffer;
+    int m_overlay_vertices;
+};
+
+#endif //MINOTAUR_CPP_GLFRAMEVIEW_H
@@ -1,10 +1,13 @@
 #include "imageviewer.h"
 #include "ui_imageviewer.h"
 
+#include "calibration.h"
 #include "cameradisplay.h"
 #include "camerathread.h"
 #include "capture.h"
 #include "converter.h"
+#include "glframeview.h"
+#include "pipelinestats.h"
 #include "preprocessor.h"
 #include "recorder.h"
 
@@ -14,7 +17,9 @@
 #include "../gui/global.h"
 #include "../gui/griddisplay.h"
 #include "../utility/logger.h"
+#include "../utility/vector.h"
 
+#include <opencv2/core/types.hpp>
 #include <opencv2/videoio.hpp>
 #include <QPainter>
 #include <QBasicTimer>
@@ -55,6 +60,9 @@ ImageViewer::ImageViewer(CameraDisplay *parent) :
     m_converter(std::make_unique<Converter>(this)),
     m_recorder(std::make_unique<Recorder>()),
 
+    m_painted_seq(0),
+    m_path_dirty(true),
+    m_frames_dropped(0),
     m_selecting_path(false) {
 
     ui->setupUi(this);
@@ -80,15 +88,29 @@ ImageViewer::ImageViewer(CameraDisplay *parent) :
     s_frame_timer.start(FRAMERATE_UPDATE_INTERVAL, this);
 
     // Connect image pipeline
-    connect(m_capture.get(), &Capture::frame_ready, m_preprocessor.get(), &Preprocessor::preprocess_frame);
+    // Frames are pushed into the preprocessor queue on the capture thread
+    connect(m_capture.get(), &Capture::frame_ready, m_preprocessor.get(), &Preprocessor::preprocess_frame,
+            Qt::DirectConnection);
     connect(m_preprocessor.get(), &Preprocessor::frame_processed, m_converter.get(), &Converter::process_frame);
-    connect(m_preprocessor.get(), &Preprocessor::frame_processed, m_recorder.get(), &Recorder::frame_received);
+    // Processed frames are pushed into the recorder queue on the
+    // preprocessor thread, see handle_recording() for captured frames
+    connect(m_preprocessor.get(), &Preprocessor::frame_processed, m_recorder.get(), &Recorder::frame_received,
+            Qt::DirectConnection);
     connect(m_converter.get(), &Converter::image_ready, this, &ImageViewer::set_image);
+    // Boxes found in the frames are mapped to field units from their size
+    connect(m_preprocessor.get(), &Preprocessor::frame_size_changed, &Main::get()->state(),
+            &CompetitionState::acquire_frame_size);
 
     // Connect UI signals
+    // Device settings are pushed first, before the camera start is queued
+    connect(parent, &CameraDisplay::display_opened, this, &ImageViewer::sync_device_params);
+    connect(parent, &CameraDisplay::camera_changed, this, &ImageViewer::sync_device_params);
     connect(parent, &CameraDisplay::display_opened, m_capture.get(), &Capture::start_capture);
     connect(parent, &CameraDisplay::display_closed, m_capture.get(), &Capture::stop_capture);
+    connect(m_capture.get(), &Capture::capture_stopped, this, &ImageViewer::log_pipeline_stats);
     connect(parent, &CameraDisplay::camera_changed, m_capture.get(), &Capture::change_camera);
+    connect(parent, &CameraDisplay::replay_changed, m_capture.get(), &Capture::change_replay);
+    connect(parent, &CameraDisplay::step_replay, m_capture.get(), &Capture::step_replay);
     connect(parent, &CameraDisplay::effect_changed, m_preprocessor.get(), &Preprocessor::use_modifier);
     connect(parent, &CameraDisplay::zoom_changed, m_preprocessor.get(), &Preprocessor::zoom_changed);
     connect(parent, &CameraDisplay::rotation_changed, m_preprocessor.get(), &Preprocessor::rotation_changed);
@@ -107,6 +129,8 @@ ImageViewer::ImageViewer(CameraDisplay *parent) :
     connect(this, &ImageViewer::increment_rotation, parent, &CameraDisplay::increment_rotation);
     connect(this, &ImageViewer::start_recording, m_recorder.get(), &Recorder::start_recording);
     connect(this, &ImageViewer::stop_recording, m_recorder.get(), &Recorder::stop_recording);
+    connect(&Main::get()->state(), &CompetitionState::path_changed, this, &ImageViewer::path_changed);
+    connect(&Main::get()->state(), &CompetitionState::walls_changed, m_grid_display.get(), &GridDisplay::apply_walls);
 }
 
 ImageViewer::~ImageViewer() {
@@ -114,39 +138,134 @@ ImageViewer::~ImageViewer() {
 }
 
 void ImageViewer::add_path_point(double pixel_x, double pixel_y) {
-    double combined_scale =
-        m_preprocessor->get_zoom_factor() *
-        m_converter->get_previous_scale();
-    double path_x = pixel_x / combined_scale;
-    double path_y = pixel_y / combined_scale;
-    Main::get()->state().append_path(path_x, path_y);
+    vector2d p = display_to_field(pixel_x, pixel_y);
+    Main::get()->state().append_path(p.x(), p.y());
 }
 
-void ImageViewer::set_image(const QImage &img) {
+void ImageViewer::set_image(const QImage &img, const FrameInfo &info) {
     // Upon first frame capture, resize the widget
-    if (m_image.isNull()) { setFixedSize(img.size()); }
+    if (m_image.isNull()) {
+        setFixedSize(img.size());
+        if (m_gl_view) { m_gl_view->setGeometry(rect()); }
+    }
     m_image = img;
-    // Trigger rerender
-    update();
+    m_image_info = info;
+    if (m_gl_view) {
+        if (update_path_nodes()) { m_gl_view->set_path(m_path_nodes); }
+        m_gl_view->set_image(img);
+    } else {
+        // Trigger rerender
+        update();
+    }
+}
+
+void ImageViewer::path_changed() {
+    m_path_dirty = true;
+    // Redraw even when no frames are arriving
+    if (m_gl_view) {
+        if (update_path_nodes()) { m_gl_view->set_path(m_path_nodes); }
+    } else {
+        update();
+    }
+}
+
+bool ImageViewer::update_path_nodes() {
+    std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current();
+    path_view view(m_preprocessor->get_zoom_factor(), m_preprocessor->get_rotation_angle(),
+                   m_converter->get_previous_scale(), m_image.size(), calibration.get());
+    if (!m_path_dirty && view == m_path_view) { return false; }
+    // Path nodes are in field units
+    const path2d &path = Main::get()->state().get_path();
+    m_path_nodes.clear();
+    for (const vector2d &node : path) {
+        vector2d v = field_to_display(node);
+        m_path_nodes.emplace_back(v.x(), v.y());
+    }
+    m_path_view = view;
+    m_path_dirty = false;
+    return true;
+}
+
+void ImageViewer::use_opengl(bool opengl) {
+    if (opengl == static_cast<bool>(m_gl_view)) { return; }
+    if (opengl) {
+        m_gl_view = std::make_unique<GLFrameView>(this);
+        // Mouse events go to the path selection and the GridDisplay
+        m_gl_view->setAttribute(Qt::WA_TransparentForMouseEvents);
+        m_gl_view->setGeometry(rect());
+        m_gl_view->lower();
+        m_gl_view->show();
+        connect(m_gl_view.get(), &GLFrameView::painted, this, &ImageViewer::record_paint);
+        update_path_nodes();
+        m_gl_view->set_path(m_path_nodes);
+        if (!m_image.isNull()) { m_gl_view->set_image(m_image); }
+    } else {
+        m_gl_view.reset();
+        update();
+    }
+}
+
+void ImageViewer::record_paint(pipeline_clock::time_point start) {
+    // Record end-to-end latency the first time each frame is painted
+    PipelineStats &stats = PipelineStats::get();
+    pipeline_clock::time_point end = stats.record_since(PipelineStats::PAINT, start);
+    if (m_image_info.seq && m_image_info.seq != m_painted_seq) {
+        stats.record(PipelineStats::END_TO_END, m_image_info.captured, end);
+        m_painted_seq = m_image_info.seq;
+    }
 }
 
 void ImageViewer::set_path(const std::vector<vector2i> &pixel_path) {
     log() << "Setting path with " << pixel_path.size() << " nodes";
     CompetitionState &state = Main::get()->state();
-    double combined_scale =
-        m_preprocessor->get_zoom_factor() *
-        m_converter->get_previous_scale();
-    double inv_scale = 1.0 / combined_scale;
-    double path_x;
-    double path_y;
     state.clear_path();
     for (const vector2i &p : pixel_path) {
-        path_x = p.x() * inv_scale;
-        path_y = p.y() * inv_scale;
-        state.append_path(path_x, path_y);
+        vector2d v = display_to_field(p.x(), p.y());
+        state.append_path(v.x(), v.y());
     }
 }
 
+vector2d ImageViewer::display_to_frame(double pixel_x, double pixel_y) const {
+    double scale = m_converter->get_previous_scale();
+    cv::Size size(qRound(m_image.width() / scale), qRound(m_image.height() / scale));
+    double x = pixel_x / scale;
+    double y = pixel_y / scale;
+    m_preprocessor->view_to_frame(size, x, y);
+    if (std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current()) {
+        cv::Point2d p = calibration->distort(cv::Point2d(x, y), size);
+        return {p.x, p.y};
+    }
+    return {x, y};
+}
+
+vector2d ImageViewer::display_to_field(double pixel_x, double pixel_y) const {
+    double scale = m_converter->get_previous_scale();
+    cv::Size size(qRound(m_image.width() / scale), qRound(m_image.height() / scale));
+    double x = pixel_x / scale;
+    double y = pixel_y / scale;
+    m_preprocessor->view_to_frame(size, x, y);
+    // The displayed frame is undistorted, so only the homography remains
+    if (std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current()) {
+        cv::Point2d f = calibration->to_field(cv::Point2d(x, y), size);
+        return {f.x, f.y};
+    }
+    return {x, y};
+}
+
+vector2d ImageViewer::field_to_display(const vector2d &field) const {
+    double scale = m_converter->get_previous_scale();
+    cv::Size size(qRound(m_image.width() / scale), qRound(m_image.height() / scale));
+    double x = field.x();
+    double y = field.y();
+    if (std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current()) {
+        cv::Point2d p = calibration->from_field(cv::Point2d(x, y), size);
+        x = p.x;
+        y = p.y;
+    }
+    m_preprocessor->frame_to_view(size, x, y);
+    return {x * scale, y * scale};
+}
+
 void ImageViewer::mousePressEvent(QMouseEvent *ev) {
     if (m_selecting_path) {
         add_path_point(ev->x(), ev->y());
@@ -159,43 +278,69 @@ void ImageViewer::timerEvent(QTimerEvent *ev) {
         int frames = m_converter->get_and_reset_frames();
         double fps = 1000.0 * frames / FRAMERATE_UPDATE_INTERVAL;
         set_frame_rate(fps);
+        ui->fps_label->setToolTip(QString::fromStdString(PipelineStats::get().summary()));
+        sync_pipeline_params();
     } else if (ev->timerId() == s_rotation_timer.timerId()) {
         Q_EMIT increment_rotation();
     }
 }
 
 void ImageViewer::paintEvent(QPaintEvent *) {
+    // The OpenGL view covers the widget and paints itself
+    if (m_gl_view) { return; }
+    pipeline_clock::time_point start = pipeline_clock::now();
     QPainter painter(this);
     // Draw the image first
     painter.drawImage(0, 0, m_image);
     painter.setRenderHint(QPainter::Antialiasing);
-    // Need to rescale the path nodes
-    double combined_scale =
-        m_preprocessor->get_zoom_factor() *
-        m_converter->get_previous_scale();
-    const path2d &path = Main::get()->state().get_path();
-    for (std::size_t i = 0; i < path.size(); ++i) {
+    update_path_nodes();
+    for (std::size_t i = 0; i < m_path_nodes.size(); ++i) {
         // Draw each node and connect lines between them
         QColor color;
         // Color based on start and end
         if (i == 0) { color = Qt::red; }
-        else if (i + 1 == path.size()) { color = Qt::blue; }
+        else if (i + 1 == m_path_nodes.size()) { color = Qt::blue; }
         else { color = Qt::green; }
-        vector2i v1 = path[i] * combined_scale;
+        const QPointF &v1 = m_path_nodes[i];
         painter.setBrush(color);
         painter.setPen(color);
-        painter.drawEllipse(v1.x() - 4, v1.y() - 4, 8, 8);
+        painter.drawEllipse(v1, 4, 4);
         if (i > 0) {
-            vector2i v0 = path[i - 1] * combined_scale;
             painter.setPen(QPen(Qt::green, 2, Qt::DashDotLine, Qt::RoundCap));
-            painter.drawLine(v0.x(), v0.y(), v1.x(), v1.y());
+            painter.drawLine(m_path_nodes[i - 1], v1);
         }
     }
     painter.end();
+    record_paint(start);
 }
 
 void ImageViewer::set_frame_rate(double frame_rate) {
-    ui->fps_label->setText(color_format(frame_rate));
+    // Show the frames dropped by the preprocessor queue since the last update
+    std::size_t dropped = m_preprocessor->frames_dropped();
+    std::size_t new_drops = dropped - m_frames_dropped;
+    m_frames_dropped = dropped;
+    QString text = color_format(frame_rate);
+    if (new_drops > 0) {
+        text.append(QString(" <font color=\"#ef2929\">-%1</font>").arg(new_drops));
+    }
+    ui->fps_label->setText(text);
+}
+
+void ImageViewer::sync_device_params() {
+    if (!g_pm) { return; }
+    m_capture->configure_device(
+        g_pm->capture_width, g_pm->capture_height,
+        g_pm->capture_fps, g_pm->capture_blocking != 0
+    );
+}
+
+void ImageViewer::sync_pipeline_params() {
+    if (!g_pm) { return; }
+    sync_device_params();
+    m_preprocessor->configure_queue(g_pm->frame_queue_depth, g_pm->frame_queue_policy);
+    m_preprocessor->analysis_scale_changed(g_pm->analysis_scale);
+    m_preprocessor->analysis_gate_changed(g_pm->analysis_gate, g_pm->analysis_max_reuse);
+    use_opengl(g_pm->display_opengl != 0);
 }
 
 void ImageViewer::set_zoom(double zoom) {
@@ -213,8 +358,20 @@ void ImageViewer::handle_recording() {
         Q_EMIT stop_recording();
     } else {
         // Grab the video save path and start recording
-        QString file = QFileDialog::getSaveFileName(this, "Save Video", QDir::currentPath(), "Videos (*.avi)");
+        QString file = QFileDialog::getSaveFileName(
+            this, "Save Video", QDir::currentPath(), "Videos (*.avi);;Raw Videos (*.mraw)");
         log() << "Saving video to: " << file;
+        // Record either the processed or the captured frames
+        bool captured = g_pm && g_pm->record_captured;
+        disconnect(m_capture.get(), &Capture::frame_ready, m_recorder.get(), &Recorder::frame_received);
+        disconnect(m_preprocessor.get(), &Preprocessor::frame_processed, m_recorder.get(), &Recorder::frame_received);
+        if (captured) {
+            connect(m_capture.get(), &Capture::frame_ready, m_recorder.get(), &Recorder::frame_received,
+                    Qt::DirectConnection);
+        } else {
+            connect(m_preprocessor.get(), &Preprocessor::frame_processed, m_recorder.get(),
+                    &Recorder::frame_received, Qt::DirectConnection);
+        }
         Q_EMIT start_recording(file, m_capture->capture_width(), m_capture->capture_height());
     }
 }
@@ -234,6 +391,13 @@ void ImageViewer::clear_path() {
     Main::get()->state().clear_path();
 }
 
+void ImageViewer::log_pipeline_stats() {
+    PipelineStats &stats = PipelineStats::get();
+    if (stats.histogram(PipelineStats::END_TO_END).count() == 0) { return; }
+    log() << "Pipeline latency:\n" << stats.summary();
+    stats.reset();
+}
+
 void ImageViewer::toggle_rotation(bool rotate) {
     if (rotate) {
         s_rotation_timer.start(ROTATE_UPDATE_INTERVAL, this);
@@ -3,6 +3,10 @@
 
 #include <QWidget>
 #include <memory>
+#include <tuple>
+#include <vector>
+
+#include "frameinfo.h"
 
 // Forward declarations
 namespace Ui {
@@ -12,18 +16,26 @@ class QPaintEvent;
 namespace nrg {
     template<typename val_t> class vector;
 }
+class CameraCalibration;
 class CameraDisplay;
+class GLFrameView;
 class GridDisplay;
 class Capture;
 class Preprocessor;
 class Converter;
 class Recorder;
 typedef nrg::vector<int> vector2i;
+typedef nrg::vector<double> vector2d;
 
 /**
  * The ImageViewer is a widget responsible for displaying the images captured
  * in the image pipeline. The class also manages the elements of the pipeline,
  * and handles most connections.
+ *
+ * Frames are painted with QPainter, or with OpenGL by a GLFrameView that
+ * covers the widget when the display_opengl parameter is set. The path
+ * overlay is mapped to display pixels only when the path or the view
+ * changes.
  */
 class ImageViewer : public QWidget {
     Q_OBJECT
@@ -36,7 +48,7 @@ public:
     /**
      * Add a point to the CompetitionState path given the pixel
      * location of the point on ImageViewer. The pixel
-     * location will be converted to true value using the combined scale.
+     * location will be converted to field units.
      *
      * @param pixel_x pixel x-axis location
      * @param pixel_y pixel y-axis location
@@ -46,7 +58,7 @@ public:
     /**
      * Clear and then set the CompetitionState path to the
      * one specified. The given path should have location in pixel
-     * values and will need to be scaled.
+     * values on ImageViewer and will be converted to field units.
      *
      * @param pixel_path
      */
@@ -57,9 +69,16 @@ public:
      * Set the image that is displayed by the image viewer. This slot is
      * called with a newly converted QImage from Converter
      *
-     * @param img frame image to display
+     * @param img  frame image to display
+     * @param info frame sequence number and timestamp
+     */
+    Q_SLOT void set_image(const QImage &img, const FrameInfo &info = FrameInfo());
+
+    /**
+     * Map a pixel on ImageViewer to the captured frame by undoing the
+     * display scale, the rotation and zoom, and the undistortion.
      */
-    Q_SLOT void set_image(const QImage &img);
+    vector2d display_to_frame(double pixel_x, double pixel_y) const;
 
     /**
      * Set the frame rate value that is displayed in the frame rate
@@ -114,6 +133,23 @@ public:
      */
     Q_SLOT void toggle_rotation(bool rotate);
 
+    /**
+     * Slot called to write the pipeline latency percentiles to the log.
+     */
+    Q_SLOT void log_pipeline_stats();
+
+    /**
+     * Slot called when the CompetitionState path changes.
+     */
+    Q_SLOT void path_changed();
+
+    /**
+     * Switch between painting frames with QPainter and with OpenGL.
+     *
+     * @param opengl whether frames are displayed with OpenGL
+     */
+    Q_SLOT void use_opengl(bool opengl);
+
     /**
      * Signal fired to indicate that rotation values should be incremented.
      */
@@ -155,6 +191,45 @@ private:
      */
     void paintEvent(QPaintEvent *ev) override;
 
+    /**
+     * Map a pixel on ImageViewer to field units by undoing the display
+     * scale, the rotation and zoom, and the field homography.
+     */
+    vector2d display_to_field(double pixel_x, double pixel_y) const;
+
+    /**
+     * @return the pixel on ImageViewer of a point in field units
+     */
+    vector2d field_to_display(const vector2d &field) const;
+
+    /**
+     * Map the path nodes to display pixels if the path or the view
+     * has changed since they were last mapped.
+     *
+     * @return whether the nodes were mapped again
+     */
+    bool update_path_nodes();
+
+    /**
+     * Record the paint time and, for a new frame, the end-to-end latency.
+     *
+     * @param start time the paint started
+     */
+    void record_paint(pipeline_clock::time_point start);
+
+    /**
+     * Forward pipeline parameters from the parameter manager
+     * to the pipeline elements.
+     */
+    void sync_pipeline_params();
+
+    /**
+     * Forward the capture device settings to the Capture. Called
+     * before a camera is started, so that it starts with the current
+     * settings rather than those of the last sync.
+     */
+    void sync_device_params();
+
 private:
     Ui::ImageViewer *ui;
 
@@ -164,6 +239,31 @@ private:
      * The currently displayed image.
      */
     QImage m_image;
+    /**
+     * Sequence number and timestamp of the displayed image.
+     */
+    FrameInfo m_image_info;
+    /**
+     * Sequence number of the last image whose end-to-end latency was recorded.
+     */
+    std::uint64_t m_painted_seq;
+
+    /**
+     * Zoom, rotation, display scale, image size, and calibration
+     * the path nodes were mapped with.
+     */
+    typedef std::tuple<double, int, double, QSize, const CameraCalibration *> path_view;
+    path_view m_path_view;
+    /**
+     * Path nodes in display pixels.
+     */
+    std::vector<QPointF> m_path_nodes;
+    bool m_path_dirty;
+
+    /**
+     * Display used in OpenGL mode, or nullptr when painting with QPainter.
+     */
+    std::unique_ptr<GLFrameView> m_gl_view;
 
     // Pipeline elements
     std::unique_ptr<Capture> m_capture;
@@ -171,6 +271,11 @@ private:
     std::unique_ptr<Converter> m_converter;
     std::unique_ptr<Recorder> m_recorder;
 
+    /**
+     * Preprocessor drop count at the last frame rate update.
+     */
+    std::size_t m_frames_dropped;
+
     /**
      * Whether mouse events should be handled to add path nodes.
      */
@@ -0,0 +1,75 @@
+#include "pipelinestats.h"
+
+#include <cstdio>
+
+PipelineStats &PipelineStats::get() {
+    static PipelineStats stats;
+    return stats;
+}
+
+PipelineStats::PipelineStats() = default;
+
+const char *PipelineStats::stage_name(Stage stage) {
+    switch (stage) {
+        case QUEUE:
+            return "queue";
+        case MODIFIER:
+            return "modifier";
+        case WARP:
+            return "warp";
+        case CVT_COLOR:
+            return "cvtColor";
+        case PREPROCESS:
+            return "preprocess";
+        case CONVERT:
+            return "convert";
+        case RECORD:
+            return "record";
+        case PAINT:
+            return "paint";
+        case END_TO_END:
+            return "end-to-end";
+        default:
+            return "unknown";
+    }
+}
+
+void PipelineStats::record(Stage stage, pipeline_clock::time_point start, pipeline_clock::time_point end) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    m_stages[stage].record(us > 0 ? static_cast<std::uint64_t>(us) : 0);
+}
+
+pipeline_clock::time_point PipelineStats::record_since(Stage stage, pipeline_clock::time_point start) {
+    pipeline_clock::time_point now = pipeline_clock::now();
+    record(stage, start, now);
+    return now;
+}
+
+const latency_histogram &PipelineStats::histogram(Stage stage) const {
+    return m_stages[stage];
+}
+
+std::string PipelineStats::summary() const {
+    std::string text;
+    char line[96];
+    std::snprintf(line, sizeof(line), "%-11s %8s %8s %8s %8s\n", "stage (ms)", "n", "p50", "p95", "p99");
+    text.append(line);
+    for (int i = 0; i < NUM_STAGES; ++i) {
+        const latency_histogram &hist = m_stages[i];
+        if (hist.count() == 0) { continue; }
+        std::snprintf(
+            line, sizeof(line), "%-11s %8llu %8.2f %8.2f %8.2f\n",
+            stage_name(static_cast<Stage>(i)),
+            static_cast<unsigned long long>(hist.count()),
+            hist.percentile(50) / 1000.0,
+            hist.percentile(95) / 1000.0,
+            hist.percentile(99) / 1000.0
+        );
+        text.append(line);
+    }
+    return text;
+}
+
+void PipelineStats::reset() {
+    for (latency_histogram &hist : m_stages) { hist.reset(); }
+}
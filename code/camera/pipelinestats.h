@@ -0,0 +1,79 @@
+#ifndef MINOTAUR_CPP_PIPELINESTATS_H
+#define MINOTAUR_CPP_PIPELINESTATS_H
+
+#include "frameinfo.h"
+#include "../utility/histogram.h"
+
+#include <string>
+
+/**
+ * Singleton that collects latency histograms for each stage of the
+ * image pipeline. Stages record their own duration when they finish,
+ * and the ImageViewer records the end-to-end latency of each frame
+ * from capture to paint.
+ *
+ * All methods are safe to call from any pipeline thread.
+ */
+class PipelineStats {
+public:
+    enum Stage {
+        // Time spent waiting in the preprocessor queue
+        QUEUE,
+        // Preprocessor substages
+        MODIFIER,
+        // Combined rotation and zoom
+        WARP,
+        CVT_COLOR,
+        // Total time in the preprocessor
+        PREPROCESS,
+        CONVERT,
+        RECORD,
+        PAINT,
+        // Capture to paint
+        END_TO_END,
+
+        NUM_STAGES
+    };
+
+    static PipelineStats &get();
+
+    static const char *stage_name(Stage stage);
+
+    /**
+     * Record a stage duration.
+     *
+     * @param stage the pipeline stage
+     * @param start the time at which the stage started
+     * @param end   the time at which the stage finished
+     */
+    void record(Stage stage, pipeline_clock::time_point start, pipeline_clock::time_point end);
+
+    /**
+     * Record a stage that started at the given time and finished now.
+     *
+     * @param stage the pipeline stage
+     * @param start the time at which the stage started
+     * @return the current time, so that consecutive stages can be chained
+     */
+    pipeline_clock::time_point record_since(Stage stage, pipeline_clock::time_point start);
+
+    const latency_histogram &histogram(Stage stage) const;
+
+    /**
+     * @return a multi-line table of p50, p95, and p99 for each stage, in milliseconds
+     */
+    std::string summary() const;
+
+    void reset();
+
+    // Singleton
+    PipelineStats(PipelineStats const &) = delete;
+    void operator=(PipelineStats const &) = delete;
+
+private:
+    PipelineStats();
+
+    latency_histogram m_stages[NUM_STAGES];
+};
+
+#endif //MINOTAUR_CPP_PIPELINESTATS_H
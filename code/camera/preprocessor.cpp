@@ -1,34 +1,107 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/videoio.hpp>
-#include <QBasicTimer>
-#include <QTimerEvent>
+#include <cmath>
 
+#include "calibration.h"
+#include "framegate.h"
 #include "preprocessor.h"
+#include "pipelinestats.h"
+#include "../utility/ring_buffer.h"
+#include "../utility/utility.h"
 #include "../video/modify.h"
 
-// Static timer instance for queue filling
-static QBasicTimer s_queue_timer;
-// Static instance of queue'd frame
-static cv::UMat s_frame;
-
-static void zoom(cv::UMat &src, cv::UMat &dest, double zoom_factor) {
-    // Crop the image to the zoom area
-    cv::Rect crop(
-        static_cast<int>(src.size().width / 2.0 - src.size().width / (2.0 * zoom_factor)),
-        static_cast<int>(src.size().height / 2.0 - src.size().height / (2.0 * zoom_factor)),
-        static_cast<int>(src.size().width / zoom_factor),
-        static_cast<int>(src.size().height / zoom_factor)
-    );
-    src = src(crop);
-    // Resize the image up to the original size
-    cv::resize(src, dest, cv::Size(), zoom_factor, zoom_factor, cv::INTER_LINEAR);
+/**
+ * Build the forward affine transform that rotates the frame about its
+ * center and then zooms into the center, cropping to the frame size.
+ *
+ * Rotation about the center c is p' = R p + t. Zoom crops the rectangle
+ * of size (w / z, h / z) centered at c and scales it up by z, which is
+ * p'' = z (p' - tl). Together, p'' = z R p + z (t - tl).
+ */
+static cv::Mat rotate_zoom_transform(const cv::Size &size, double angle, double zoom_factor) {
+    cv::Point2f center(size.width * 0.5f, size.height * 0.5f);
+    cv::Mat mat = cv::getRotationMatrix2D(center, angle, 1.0);
+    double tl_x = size.width / 2.0 - size.width / (2.0 * zoom_factor);
+    double tl_y = size.height / 2.0 - size.height / (2.0 * zoom_factor);
+    mat.at<double>(0, 2) -= tl_x;
+    mat.at<double>(1, 2) -= tl_y;
+    mat *= zoom_factor;
+    return mat;
 }
 
-static void rotate(cv::UMat& src, double angle, cv::UMat& dst) {
-    // Rotate the image
-    cv::Point2f pt_cp(src.cols * 0.5f, src.rows * 0.5f);
-    cv::Mat mat = cv::getRotationMatrix2D(pt_cp, angle, 1.0);
-    cv::warpAffine(src, dst, mat, src.size(), cv::INTER_CUBIC);
+/**
+ * Cached remap tables for the combined lens undistortion, rotation and
+ * zoom transform. The tables are rebuilt only when the rotation, zoom,
+ * or calibration changes, or when the frame size changes.
+ */
+struct Preprocessor::Warp {
+    Warp() :
+        identity(true) {}
+
+    void rebuild(const cv::Size &t_size, double angle, double zoom_factor,
+                 const std::shared_ptr<const CameraCalibration> &t_calibration);
+
+    cv::Size size;
+    // Calibration the tables undistort with, if any
+    std::shared_ptr<const CameraCalibration> calibration;
+    // Fixed-point maps produced by cv::convertMaps
+    cv::UMat map1;
+    cv::UMat map2;
+    // Whether the transform does nothing and can be skipped
+    bool identity;
+};
+
+void Preprocessor::Warp::rebuild(const cv::Size &t_size, double angle, double zoom_factor,
+                                 const std::shared_ptr<const CameraCalibration> &t_calibration) {
+    size = t_size;
+    calibration = t_calibration;
+    bool affine = std::fmod(angle, 360.0) != 0.0 || zoom_factor != 1.0;
+    identity = !affine && !calibration;
+    if (identity) {
+        map1.release();
+        map2.release();
+        return;
+    }
+    // Destination to source mapping for every output pixel
+    cv::Mat map_x(size, CV_32FC1);
+    cv::Mat map_y(size, CV_32FC1);
+    if (affine) {
+        cv::Mat inv;
+        cv::invertAffineTransform(rotate_zoom_transform(size, angle, zoom_factor), inv);
+        auto a = inv.ptr<double>(0);
+        auto b = inv.ptr<double>(1);
+        for (int y = 0; y < size.height; ++y) {
+            auto *mx = map_x.ptr<float>(y);
+            auto *my = map_y.ptr<float>(y);
+            for (int x = 0; x < size.width; ++x) {
+                mx[x] = static_cast<float>(a[0] * x + a[1] * y + a[2]);
+                my[x] = static_cast<float>(b[0] * x + b[1] * y + b[2]);
+            }
+        }
+    }
+    if (calibration) {
+        // The rotated and zoomed view is of the undistorted frame, so the
+        // undistortion tables are looked up at the affine source points.
+        // Points outside the frame stay outside it.
+        cv::Mat undistort_x;
+        cv::Mat undistort_y;
+        calibration->undistort_maps(size, undistort_x, undistort_y);
+        if (affine) {
+            cv::Mat fused_x;
+            cv::Mat fused_y;
+            cv::remap(undistort_x, fused_x, map_x, map_y, cv::INTER_LINEAR,
+                      cv::BORDER_CONSTANT, cv::Scalar(-1));
+            cv::remap(undistort_y, fused_y, map_x, map_y, cv::INTER_LINEAR,
+                      cv::BORDER_CONSTANT, cv::Scalar(-1));
+            map_x = fused_x;
+            map_y = fused_y;
+        } else {
+            map_x = undistort_x;
+            map_y = undistort_y;
+        }
+    }
+    // Fixed-point maps are considerably faster to remap with
+    cv::convertMaps(map_x, map_y, map1, map2, CV_16SC2);
 }
 
 struct PreprocessorDelegate {
@@ -38,73 +111,214 @@ struct PreprocessorDelegate {
      * and Qt cannot handle non-const reference to Mat as a metatype.
      *
      * @param frame frame to preprocess
+     * @param info  frame sequence number and timestamp
      */
-    static void preprocess_frame_delegate(Preprocessor *pp, cv::UMat frame);
+    static void preprocess_frame_delegate(Preprocessor *pp, cv::UMat frame, const FrameInfo &info);
 };
 
-void PreprocessorDelegate::preprocess_frame_delegate(Preprocessor *pp, cv::UMat frame) {
-    // Modifier frame
-    if (pp->m_modifier) { pp->m_modifier->modify(frame); }
-    // Rotate frame
-    rotate(frame, static_cast<double>(pp->m_rotation_angle), frame);
-    // Frame zoom
-    zoom(frame, frame, pp->m_zoom_factor);
+void PreprocessorDelegate::preprocess_frame_delegate(Preprocessor *pp, cv::UMat frame, const FrameInfo &info) {
+    PipelineStats &stats = PipelineStats::get();
+    pipeline_clock::time_point start = pipeline_clock::now();
+    pipeline_clock::time_point t = start;
+    if (info.seq) { stats.record(PipelineStats::QUEUE, info.captured, start); }
+    FrameInfo out = info;
+    // The warp is rebuilt for each new frame size after the modifier runs
+    Preprocessor::Warp &warp = *pp->m_warp;
+    if (warp.size != frame.size()) { Q_EMIT pp->frame_size_changed(frame.size()); }
+    // Modifier frame, analyzed only if it changed
+    if (pp->m_modifier) {
+        if (pp->m_gate_reset.exchange(false)) { pp->m_gate->reset(); }
+        // Analyze the frame anyway, and make it the reference
+        if (pp->m_modifier->needs_analysis()) { pp->m_gate->reset(); }
+        if (pp->m_gate->changed(frame, pp->m_gate_threshold, pp->m_gate_max_reuse)) {
+            // Velocities are measured between capture times
+            pp->m_modifier->process(frame, pp->m_analysis_scale, info.seq ? info.captured : start);
+        } else {
+            pp->m_modifier->process_reused(frame);
+            out.reused = true;
+            ++pp->m_reused;
+        }
+        t = stats.record_since(PipelineStats::MODIFIER, t);
+    }
+    // Undistort, rotate and zoom frame in a single resample
+    std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current();
+    if (pp->m_warp_dirty.exchange(false) || warp.size != frame.size() || warp.calibration != calibration) {
+        warp.rebuild(frame.size(), pp->m_rotation_angle, pp->m_zoom_factor, calibration);
+    }
+    if (!warp.identity) {
+        cv::UMat warped;
+        cv::remap(frame, warped, warp.map1, warp.map2, cv::INTER_LINEAR);
+        frame = warped;
+        t = stats.record_since(PipelineStats::WARP, t);
+    }
     // Convert to RGB
-    if (pp->m_convert_rgb) { cv::cvtColor(frame, frame, CV_BGR2RGB); }
+    if (pp->m_convert_rgb) {
+        cv::cvtColor(frame, frame, CV_BGR2RGB);
+        stats.record_since(PipelineStats::CVT_COLOR, t);
+    }
+    stats.record_since(PipelineStats::PREPROCESS, start);
     // Emit preprocessed frame
-    Q_EMIT pp->frame_processed(frame);
+    Q_EMIT pp->frame_processed(frame, out);
 }
 
 
 Preprocessor::Preprocessor() :
+    m_queue(std::make_shared<frame_ring>(DEFAULT_QUEUE_DEPTH, frame_ring::DROP_OLDEST)),
+    m_scheduled(false),
+    m_queue_depth(DEFAULT_QUEUE_DEPTH),
+    m_queue_policy(DROP_OLDEST),
+    m_queue_dirty(false),
+    m_queued_base(0),
+    m_dropped_base(0),
+    m_processed(0),
+    m_reused(0),
+    m_warp(std::make_unique<Warp>()),
+    m_warp_dirty(true),
+    m_analysis_scale(1.0),
+    m_gate(std::make_unique<FrameGate>()),
+    m_gate_threshold(0.0),
+    m_gate_max_reuse(0),
+    m_gate_reset(false),
     m_zoom_factor(1.0),
     m_rotation_angle(0),
-    m_convert_rgb(true),
-    m_process_all(false) {}
+    m_convert_rgb(true) {}
+
+Preprocessor::~Preprocessor() = default;
 
 void Preprocessor::zoom_changed(double zoom_factor) {
     m_zoom_factor = zoom_factor;
+    m_warp_dirty = true;
 }
 
 void Preprocessor::rotation_changed(int angle) {
     m_rotation_angle = angle;
+    m_warp_dirty = true;
 }
 
 void Preprocessor::convert_rgb(bool convert_rgb) {
     m_convert_rgb = convert_rgb;
 }
 
+void Preprocessor::analysis_scale_changed(double scale) {
+    if (m_analysis_scale.exchange(scale) != scale) { m_gate_reset = true; }
+}
+
+void Preprocessor::analysis_gate_changed(double threshold, int max_reuse) {
+    m_gate_threshold = threshold;
+    m_gate_max_reuse = max_reuse;
+}
+
 void Preprocessor::use_modifier(const std::shared_ptr<VideoModifier> &modifier) {
     m_modifier = modifier;
+    m_gate_reset = true;
 }
 
-void Preprocessor::preprocess_frame(const cv::UMat &frame) {
-    // Queue the frame unless all frames are to be processed
-    if (m_process_all)
-    { PreprocessorDelegate::preprocess_frame_delegate(this, frame); }
-    else { queue_frame(frame); }
+void Preprocessor::preprocess_frame(const cv::UMat &frame, const FrameInfo &info) {
+    // Runs on the producer thread; push and wake the preprocessor thread
+    if (m_queue_dirty.exchange(false)) { replace_queue(); }
+    std::shared_ptr<frame_ring> queue = std::atomic_load(&m_queue);
+    queue->push(queued_frame(frame, info));
+    schedule();
 }
 
-void Preprocessor::queue_frame(const cv::UMat &frame) {
-    // Load the frame into the single-element queue
-    s_frame = frame;
-    // If there is no current frame being processed, start the timer
-    if (!s_queue_timer.isActive()) { s_queue_timer.start(0, this); }
+void Preprocessor::schedule() {
+    // Only post a single wake up at a time so that the event
+    // queue does not fill up with process requests
+    bool expected = false;
+    if (m_scheduled.compare_exchange_strong(expected, true)) {
+        QMetaObject::invokeMethod(this, "process_queue", Qt::QueuedConnection);
+    }
 }
 
-void Preprocessor::timerEvent(QTimerEvent *ev) {
-    if (ev->timerId() != s_queue_timer.timerId()) { return; }
-    // Process the frame; this function is blocking and will not
-    // return until the frame is processed, and usually has slower
-    // execution time, which limits frame rate
+void Preprocessor::process_queue() {
+    std::shared_ptr<frame_ring> queue = std::atomic_load(&m_queue);
+    queued_frame frame;
+    if (queue->pop(frame)) {
+        // Process the frame; this function is blocking and will not
+        // return until the frame is processed, and usually has slower
+        // execution time, which limits frame rate
+        PreprocessorDelegate::preprocess_frame_delegate(this, frame.first, frame.second);
+        ++m_processed;
+    }
+    // Clear the flag before checking the queue again so that a frame
+    // pushed in between is not left without a wake up
+    m_scheduled = false;
+    if (!std::atomic_load(&m_queue)->empty()) { schedule(); }
+}
 
-    // Pass copy of pointer
-    PreprocessorDelegate::preprocess_frame_delegate(this, s_frame);
-    s_frame.release();
-    // Stop the timer so that the next received frame can be processed
-    s_queue_timer.stop();
+void Preprocessor::configure_queue(int depth, int policy) {
+    m_queue_depth = depth < 1 ? 1 : depth;
+    m_queue_policy = policy;
+    m_queue_dirty = true;
+}
+
+void Preprocessor::replace_queue() {
+    int depth = m_queue_depth;
+    auto overflow = m_queue_policy == DROP_NEWEST ? frame_ring::DROP_NEWEST : frame_ring::DROP_OLDEST;
+    std::shared_ptr<frame_ring> queue = std::atomic_load(&m_queue);
+    if (queue->capacity() == static_cast<std::size_t>(depth) && queue->policy() == overflow) {
+        return;
+    }
+    std::shared_ptr<frame_ring> replacement = std::make_shared<frame_ring>(depth, overflow);
+    queue = std::atomic_exchange(&m_queue, replacement);
+    // Nothing is pushed into the old queue anymore; carry over the frames
+    // the preprocessor thread has not taken from it
+    std::size_t moved = 0;
+    queued_frame frame;
+    while (queue->pop(frame)) {
+        replacement->push(frame);
+        ++moved;
+    }
+    m_queued_base += queue->pushed() - moved;
+    m_dropped_base += queue->dropped();
 }
 
 double Preprocessor::get_zoom_factor() const {
     return m_zoom_factor;
 }
+
+int Preprocessor::get_rotation_angle() const {
+    return m_rotation_angle;
+}
+
+void Preprocessor::view_to_frame(const cv::Size &size, double &x, double &y) const {
+    cv::Mat inv;
+    cv::invertAffineTransform(rotate_zoom_transform(size, m_rotation_angle, m_zoom_factor), inv);
+    auto a = inv.ptr<double>(0);
+    auto b = inv.ptr<double>(1);
+    double fx = a[0] * x + a[1] * y + a[2];
+    double fy = b[0] * x + b[1] * y + b[2];
+    x = fx;
+    y = fy;
+}
+
+void Preprocessor::frame_to_view(const cv::Size &size, double &x, double &y) const {
+    cv::Mat mat = rotate_zoom_transform(size, m_rotation_angle, m_zoom_factor);
+    auto a = mat.ptr<double>(0);
+    auto b = mat.ptr<double>(1);
+    double vx = a[0] * x + a[1] * y + a[2];
+    double vy = b[0] * x + b[1] * y + b[2];
+    x = vx;
+    y = vy;
+}
+
+std::size_t Preprocessor::frames_queued() const {
+    return m_queued_base + std::atomic_load(&m_queue)->pushed();
+}
+
+std::size_t Preprocessor::frames_dropped() const {
+    return m_dropped_base + std::atomic_load(&m_queue)->dropped();
+}
+
+std::size_t Preprocessor::frames_processed() const {
+    return m_processed;
+}
+
+std::size_t Preprocessor::frames_reused() const {
+    return m_reused;
+}
+
+bool Preprocessor::idle() const {
+    // The wake up flag stays set until the frame it was posted for is processed
+    return !m_scheduled && std::atomic_load(&m_queue)->empty();
+}
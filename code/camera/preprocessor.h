@@ -2,12 +2,21 @@
 #define MINOTAUR_CPP_PREPROCESSOR_H
 
 #include <QObject>
+#include <atomic>
 #include <memory>
+#include <utility>
+
+#include "frameinfo.h"
 
 // Forward declarations
 namespace cv {
     class UMat;
+    template<typename _Tp> class Size_;
+    typedef Size_<int> Size;
 }
+template<typename val_t> class ring_buffer;
+class CameraCalibration;
+class FrameGate;
 class VideoModifier;
 
 /**
@@ -15,25 +24,66 @@ class VideoModifier;
  * processes run on the raw image from the capture output before sending
  * the frame to the Converter.
  *
- * This includes VideoModifier, zoom, and rotation.
+ * This includes VideoModifier, lens undistortion, zoom, and rotation.
+ * Undistortion with the installed CameraCalibration, zoom and rotation
+ * are applied together as a single remap whose tables are rebuilt only
+ * when one of them changes. The modifier runs before the remap, so its
+ * results are in raw frame pixels. It analyzes a copy of the frame scaled
+ * by the analysis scale and draws its results onto the full frame. Frames
+ * that are unchanged from the last analyzed frame, according to the
+ * FrameGate, are not analyzed; the last results are drawn onto them and
+ * they are marked as reused.
+ *
+ * Frame processing is as such: a frame is received from the Capture on
+ * the capture thread and is pushed into a bounded lock-free ring. The
+ * preprocessor thread is woken up and drains the ring one frame at a time.
+ * When the ring is full, either the oldest queued frame or the new frame
+ * is dropped, according to the queue policy, and the drop is counted.
  *
- * Frame processing is as such: a frame is received from the Capture and
- * is placed in a "single-element queue". When the current frame has been
- * processed, the next frame in the queue is processed. If a frame is
- * received while the current frame is being processed, it is ignored.
+ * The default queue holds a single frame and drops the oldest, so that
+ * the newest frame is always the next one processed.
  */
 class Preprocessor : public QObject {
 Q_OBJECT
 
 public:
+    enum {
+        DEFAULT_QUEUE_DEPTH = 1
+    };
+
+    enum QueuePolicy {
+        // Newer frames replace the oldest queued frames
+        DROP_OLDEST = 0,
+        // Newer frames are discarded while the queue is full
+        DROP_NEWEST = 1
+    };
+
     Preprocessor();
 
+    ~Preprocessor() override;
+
     /**
-     * Queue the frame to be preprocessed.
+     * Queue the frame to be preprocessed. This slot should be connected
+     * with Qt::DirectConnection so that the frame is pushed into the
+     * ring on the producer's thread instead of through the event queue.
      *
      * @param frame the frame to preprocess
+     * @param info  frame sequence number and timestamp
+     */
+    Q_SLOT void preprocess_frame(const cv::UMat &frame, const FrameInfo &info = FrameInfo());
+
+    /**
+     * Replace the frame queue with one of the given depth and overflow
+     * policy. The producer replaces the queue before pushing its next
+     * frame, and moves the frames still in the old queue to the new one,
+     * where those that do not fit are dropped and counted. Does nothing
+     * if the queue already has this configuration. Safe to call from
+     * any thread.
+     *
+     * @param depth  maximum number of queued frames
+     * @param policy one of QueuePolicy
      */
-    Q_SLOT void preprocess_frame(const cv::UMat &frame);
+    Q_SLOT void configure_queue(int depth, int policy);
 
     Q_SLOT void zoom_changed(double zoom_factor);
 
@@ -41,6 +91,24 @@ public:
 
     Q_SLOT void convert_rgb(bool convert_rgb);
 
+    /**
+     * Set the scale at which the modifier analyzes frames, relative
+     * to the captured frame. Safe to call from any thread.
+     *
+     * @param scale analysis scale in (0, 1]
+     */
+    Q_SLOT void analysis_scale_changed(double scale);
+
+    /**
+     * Set how much a frame must change to be analyzed. Safe to call
+     * from any thread.
+     *
+     * @param threshold largest block mean gray level change of an
+     *                  unchanged frame, or 0 to analyze every frame
+     * @param max_reuse most frames in a row that are not analyzed
+     */
+    Q_SLOT void analysis_gate_changed(double threshold, int max_reuse);
+
     /**
      * Replace the modifier in the class with the provided one.
      * This slot is fired when the modifier has been changed on the UI.
@@ -53,35 +121,135 @@ public:
      * Signal emitted when the frame has been processed.
      *
      * @param frame processed frame
+     * @param info  frame sequence number and timestamp
+     */
+    Q_SIGNAL void frame_processed(const cv::UMat &frame, const FrameInfo &info);
+
+    /**
+     * Emitted before the first frame of a new size is analyzed, so that
+     * results in its pixels are mapped from the right size.
      */
-    Q_SIGNAL void frame_processed(const cv::UMat &frame);
+    Q_SIGNAL void frame_size_changed(const cv::Size &size);
 
     double get_zoom_factor() const;
 
+    int get_rotation_angle() const;
+
+    /**
+     * Map a point on the displayed frame to the undistorted frame by
+     * undoing the rotation and zoom.
+     *
+     * @param size frame size in pixels
+     * @param x    horizontal position, replaced with the mapped position
+     * @param y    vertical position, replaced with the mapped position
+     */
+    void view_to_frame(const cv::Size &size, double &x, double &y) const;
+
+    /**
+     * Map a point on the undistorted frame to the displayed frame.
+     *
+     * @see view_to_frame
+     */
+    void frame_to_view(const cv::Size &size, double &x, double &y) const;
+
+    /**
+     * @return number of frames accepted into the queue
+     */
+    std::size_t frames_queued() const;
+
+    /**
+     * @return number of frames dropped because the queue was full
+     */
+    std::size_t frames_dropped() const;
+
+    /**
+     * @return number of frames that have been preprocessed and emitted
+     */
+    std::size_t frames_processed() const;
+
+    /**
+     * @return number of processed frames that were not analyzed
+     *         and reused the results of an earlier frame
+     */
+    std::size_t frames_reused() const;
+
+    /**
+     * @return whether no frame is queued or being processed; the
+     *         counters are final once the producer has stopped as well
+     */
+    bool idle() const;
+
 private:
     // Delegate friend declaration
     friend struct PreprocessorDelegate;
 
+    typedef std::pair<cv::UMat, FrameInfo> queued_frame;
+    typedef ring_buffer<queued_frame> frame_ring;
+
     /**
-     * Queue a frame to be processed.
-     *
-     * @param frame
+     * Process the oldest frame in the queue, then reschedule itself
+     * through the event loop if more frames are waiting.
      */
-    void queue_frame(const cv::UMat &frame);
+    Q_SLOT void process_queue();
 
     /**
-     * Timer fired to trigger a frame processing.
-     *
-     * @param ev timer event
+     * Wake the preprocessor thread unless it has already been woken.
      */
-    void timerEvent(QTimerEvent *ev) override;
+    void schedule();
+
+    /**
+     * Replace the queue with the configured one. Runs on the producer
+     * thread, so that no frame is pushed into the old queue after it.
+     */
+    void replace_queue();
 
     std::shared_ptr<VideoModifier> m_modifier;
 
+    /**
+     * Frame queue shared between the producer and this thread. Held
+     * through a shared pointer so that it may be swapped atomically.
+     */
+    std::shared_ptr<frame_ring> m_queue;
+    /**
+     * Whether a process_queue() call has been posted and not yet run.
+     */
+    std::atomic<bool> m_scheduled;
+    /**
+     * Queue configuration to apply before the next frame is pushed.
+     */
+    std::atomic<int> m_queue_depth;
+    std::atomic<int> m_queue_policy;
+    std::atomic<bool> m_queue_dirty;
+
+    // Counters carried over when the queue is replaced
+    std::atomic<std::size_t> m_queued_base;
+    std::atomic<std::size_t> m_dropped_base;
+    std::atomic<std::size_t> m_processed;
+    std::atomic<std::size_t> m_reused;
+
+    // Cached undistortion, rotation and zoom remap tables
+    struct Warp;
+    std::unique_ptr<Warp> m_warp;
+    /**
+     * Set when the rotation or zoom changes so that the preprocessor
+     * thread rebuilds the remap tables before the next frame.
+     */
+    std::atomic<bool> m_warp_dirty;
+
+    std::atomic<double> m_analysis_scale;
+
+    std::unique_ptr<FrameGate> m_gate;
+    std::atomic<double> m_gate_threshold;
+    std::atomic<int> m_gate_max_reuse;
+    /**
+     * Set when the modifier or analysis scale changes, since the
+     * last results no longer hold for an unchanged frame.
+     */
+    std::atomic<bool> m_gate_reset;
+
     double m_zoom_factor;
     int m_rotation_angle;
     bool m_convert_rgb;
-    bool m_process_all;
 };
 
 #endif //MINOTAUR_CPP_PREPROCESSOR_H
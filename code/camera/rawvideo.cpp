@@ -0,0 +1,199 @@
+#include <QFile>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "rawvideo.h"
+#include "../utility/utility.h"
+
+namespace {
+    const char MAGIC[8] = {'M', 'N', 'T', 'R', 'R', 'A', 'W', '1'};
+
+    struct FileHeader {
+        char magic[8];
+        std::int32_t width;
+        std::int32_t height;
+        std::int32_t type;
+        std::int32_t reserved;
+        // Updated after every frame
+        std::uint64_t frames;
+    };
+
+    struct RecordHeader {
+        std::int64_t us;
+        std::uint64_t seq;
+    };
+
+    // Types of the frames the Recorder writes
+    bool is_frame_type(int type) {
+        return type == CV_8UC1 || type == CV_8UC3 || type == CV_8UC4;
+    }
+
+    std::size_t record_bytes(const cv::Size &size, int type) {
+        return sizeof(RecordHeader) + size.area() * CV_ELEM_SIZE(type);
+    }
+}
+
+const char *const rawvideo::EXTENSION = ".mraw";
+
+bool rawvideo::is_raw_file(const QString &file) {
+    return file.endsWith(EXTENSION, Qt::CaseInsensitive);
+}
+
+RawVideoWriter::RawVideoWriter() :
+    m_header(nullptr),
+    m_chunk(nullptr),
+    m_chunk_used(0),
+    m_type(0),
+    m_record_bytes(0),
+    m_frames(0) {}
+
+RawVideoWriter::~RawVideoWriter() {
+    close();
+}
+
+bool RawVideoWriter::open(const QString &file, const cv::Size &size, int type) {
+    close();
+    m_file = std::make_unique<QFile>(file);
+    if (!m_file->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        m_file.reset();
+        return false;
+    }
+    m_size = size;
+    m_type = type;
+    m_record_bytes = record_bytes(size, type);
+    m_frames = 0;
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.width = size.width;
+    header.height = size.height;
+    header.type = type;
+    m_file->write(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_file->flush();
+    m_header = m_file->map(0, sizeof(FileHeader));
+    if (!m_header || !map_chunk()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool RawVideoWriter::is_open() const {
+    return m_file != nullptr;
+}
+
+bool RawVideoWriter::map_chunk() {
+    if (m_chunk) { m_file->unmap(m_chunk); }
+    m_chunk = nullptr;
+    qint64 offset = sizeof(FileHeader) + m_frames * m_record_bytes;
+    qint64 length = FRAMES_PER_CHUNK * m_record_bytes;
+    if (!m_file->resize(offset + length)) { return false; }
+    m_chunk = m_file->map(offset, length);
+    m_chunk_used = 0;
+    return m_chunk != nullptr;
+}
+
+bool RawVideoWriter::write(const cv::UMat &frame, std::int64_t us, std::uint64_t seq) {
+    if (!is_open() || frame.size() != m_size || frame.type() != m_type) { return false; }
+    if (m_chunk_used == FRAMES_PER_CHUNK && !map_chunk()) { return false; }
+    uchar *record = m_chunk + m_chunk_used * m_record_bytes;
+    RecordHeader header{us, seq};
+    std::memcpy(record, &header, sizeof(header));
+    // Copy the pixels straight into the mapped file
+    cv::Mat pixels(m_size, m_type, record + sizeof(RecordHeader));
+    frame.copyTo(pixels);
+    ++m_chunk_used;
+    ++m_frames;
+    std::uint64_t frames = m_frames;
+    std::memcpy(m_header + offsetof(FileHeader, frames), &frames, sizeof(frames));
+    return true;
+}
+
+void RawVideoWriter::close() {
+    if (!m_file) { return; }
+    if (m_chunk) { m_file->unmap(m_chunk); }
+    if (m_header) { m_file->unmap(m_header); }
+    m_chunk = nullptr;
+    m_header = nullptr;
+    // Trim the unused records of the last chunk
+    m_file->resize(sizeof(FileHeader) + m_frames * m_record_bytes);
+    m_file->close();
+    m_file.reset();
+}
+
+std::size_t RawVideoWriter::frames() const {
+    return m_frames;
+}
+
+RawVideoReader::RawVideoReader() :
+    m_data(nullptr),
+    m_type(0),
+    m_record_bytes(0),
+    m_frames(0) {}
+
+RawVideoReader::~RawVideoReader() {
+    close();
+}
+
+bool RawVideoReader::open(const QString &file) {
+    close();
+    m_file = std::make_unique<QFile>(file);
+    if (!m_file->open(QIODevice::ReadOnly) ||
+        m_file->size() < static_cast<qint64>(sizeof(FileHeader))) {
+        close();
+        return false;
+    }
+    m_data = m_file->map(0, m_file->size());
+    FileHeader header{};
+    if (m_data) { std::memcpy(&header, m_data, sizeof(header)); }
+    if (!m_data || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.width <= 0 || header.height <= 0 || !is_frame_type(header.type)) {
+        close();
+        return false;
+    }
+    m_size = cv::Size(header.width, header.height);
+    m_type = header.type;
+    m_record_bytes = record_bytes(m_size, m_type);
+    // Never trust the count past what the file holds
+    auto available = static_cast<std::size_t>((m_file->size() - sizeof(FileHeader)) / m_record_bytes);
+    m_frames = std::min(static_cast<std::size_t>(header.frames), available);
+    return true;
+}
+
+bool RawVideoReader::is_open() const {
+    return m_data != nullptr;
+}
+
+void RawVideoReader::close() {
+    if (m_file && m_data) { m_file->unmap(m_data); }
+    m_data = nullptr;
+    m_frames = 0;
+    m_file.reset();
+}
+
+std::size_t RawVideoReader::frames() const {
+    return m_frames;
+}
+
+cv::Size RawVideoReader::size() const {
+    return m_size;
+}
+
+int RawVideoReader::type() const {
+    return m_type;
+}
+
+const uchar *RawVideoReader::record(std::size_t index) const {
+    return m_data + sizeof(FileHeader) + index * m_record_bytes;
+}
+
+std::int64_t RawVideoReader::timestamp(std::size_t index) const {
+    RecordHeader header{};
+    std::memcpy(&header, record(index), sizeof(header));
+    return header.us;
+}
+
+cv::Mat RawVideoReader::frame(std::size_t index) const {
+    auto *pixels = const_cast<uchar *>(record(index) + sizeof(RecordHeader));
+    return cv::Mat(m_size, m_type, pixels);
+}
@@ -0,0 +1,161 @@
+#ifndef MINOTAUR_CPP_RAWVIDEO_H
+#define MINOTAUR_CPP_RAWVIDEO_H
+
+#include <opencv2/core/core.hpp>
+#include <QString>
+#include <cstdint>
+#include <memory>
+
+// Forward declarations
+class QFile;
+
+/**
+ * Uncompressed video container with per-frame timestamps.
+ *
+ * The file is a fixed header followed by fixed-size frame records, each
+ * holding the frame capture time in microseconds, its sequence number, and
+ * the raw pixels. Frames are written through a memory map, so writing a
+ * frame is a single copy into the page cache, and the frame count in the
+ * header is updated after every frame so that a recording interrupted by a
+ * crash can still be read.
+ */
+namespace rawvideo {
+    /**
+     * File extension of raw recordings.
+     */
+    extern const char *const EXTENSION;
+
+    /**
+     * @param file a video file path
+     * @return whether the file is a raw recording, by its extension
+     */
+    bool is_raw_file(const QString &file);
+}
+
+class RawVideoWriter {
+public:
+    enum {
+        // Number of frames the file grows by at a time
+        FRAMES_PER_CHUNK = 32
+    };
+
+    RawVideoWriter();
+
+    ~RawVideoWriter();
+
+    /**
+     * Create the file, replacing any existing one.
+     *
+     * @param file  path of the file
+     * @param size  dimensions of every frame
+     * @param type  OpenCV type of every frame
+     * @return true if the file was created
+     */
+    bool open(const QString &file, const cv::Size &size, int type);
+
+    bool is_open() const;
+
+    /**
+     * Append a frame.
+     *
+     * @param frame frame of the size and type given to open()
+     * @param us    frame capture time in microseconds
+     * @param seq   frame sequence number
+     * @return false if the frame does not match or could not be written
+     */
+    bool write(const cv::UMat &frame, std::int64_t us, std::uint64_t seq);
+
+    /**
+     * Unmap the file and trim it to the written frames.
+     */
+    void close();
+
+    /**
+     * @return number of frames written
+     */
+    std::size_t frames() const;
+
+    // Disable copy constructor and assignment
+    RawVideoWriter(const RawVideoWriter &) = delete;
+    RawVideoWriter &operator=(const RawVideoWriter &) = delete;
+
+private:
+    /**
+     * Grow the file and map the next chunk of frame records.
+     */
+    bool map_chunk();
+
+    std::unique_ptr<QFile> m_file;
+    /**
+     * Mapped file header, kept to update the frame count.
+     */
+    uchar *m_header;
+    /**
+     * Mapped chunk of frame records being filled.
+     */
+    uchar *m_chunk;
+    /**
+     * Number of records in the chunk that have been written.
+     */
+    std::size_t m_chunk_used;
+
+    cv::Size m_size;
+    int m_type;
+    std::size_t m_record_bytes;
+    std::size_t m_frames;
+};
+
+class RawVideoReader {
+public:
+    RawVideoReader();
+
+    ~RawVideoReader();
+
+    /**
+     * Open and map a raw recording.
+     *
+     * @param file path of the recording
+     * @return true if the file is a valid recording of 8-bit frames
+     *         with one, three or four channels
+     */
+    bool open(const QString &file);
+
+    bool is_open() const;
+
+    void close();
+
+    std::size_t frames() const;
+
+    cv::Size size() const;
+
+    int type() const;
+
+    /**
+     * @param index frame index
+     * @return capture time of the frame in microseconds
+     */
+    std::int64_t timestamp(std::size_t index) const;
+
+    /**
+     * @param index frame index
+     * @return header over the mapped frame pixels, valid until close()
+     */
+    cv::Mat frame(std::size_t index) const;
+
+    // Disable copy constructor and assignment
+    RawVideoReader(const RawVideoReader &) = delete;
+    RawVideoReader &operator=(const RawVideoReader &) = delete;
+
+private:
+    const uchar *record(std::size_t index) const;
+
+    std::unique_ptr<QFile> m_file;
+    uchar *m_data;
+
+    cv::Size m_size;
+    int m_type;
+    std::size_t m_record_bytes;
+    std::size_t m_frames;
+};
+
+#endif //MINOTAUR_CPP_RAWVIDEO_H
@@ -1,42 +1,132 @@
 #include <opencv2/videoio/videoio_c.h>
 #include <opencv2/videoio.hpp>
+#include <QFile>
 
+#include "pipelinestats.h"
+#include "rawvideo.h"
 #include "recorder.h"
+#include "replaycamera.h"
+#include "../utility/logger.h"
+#include "../utility/ring_buffer.h"
 #include "../utility/utility.h"
 
 Recorder::Recorder(int frame_rate, bool color) :
+    m_queue(std::make_unique<frame_ring>(ENCODE_QUEUE_DEPTH, frame_ring::DROP_NEWEST)),
+    m_scheduled(false),
+    m_dropped(0),
+    m_written(0),
     m_frame_rate(frame_rate),
     m_color(color),
     m_recording(false) {}
 
+Recorder::~Recorder() = default;
+
 bool Recorder::is_recording() const {
     return m_recording;
 }
 
+std::size_t Recorder::frames_written() const {
+    return m_written;
+}
+
+std::size_t Recorder::frames_dropped() const {
+    return m_dropped;
+}
+
 void Recorder::start_recording(const QString &file, int width, int height) {
-    // Create the video writer
-    m_video_writer = std::make_unique<cv::VideoWriter>(
-        file.toStdString(),
-        CV_FOURCC('M', 'J', 'P', 'G'),
-        m_frame_rate,
-        cv::Size(width, height),
-        m_color
-    );
+    // Discard frames left over from a previous recording
+    queued_frame stale;
+    while (m_queue->pop(stale));
+    m_written = 0;
+    m_dropped = 0;
+    if (rawvideo::is_raw_file(file)) {
+        // The raw writer takes the size and type of the first frame
+        m_raw_writer = std::make_unique<RawVideoWriter>();
+        m_raw_file = file;
+    } else {
+        // Create the video writer
+        m_video_writer = std::make_unique<cv::VideoWriter>(
+            file.toStdString(),
+            CV_FOURCC('M', 'J', 'P', 'G'),
+            m_frame_rate,
+            cv::Size(width, height),
+            m_color
+        );
+        m_timestamps = std::make_unique<QFile>(ReplayCamera::timestamps_file(file));
+        if (!m_timestamps->open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            m_timestamps.reset();
+        }
+    }
     m_recording = true;
 }
 
 void Recorder::stop_recording() {
+    m_recording = false;
+    // Write whatever is still queued
+    encode_queue();
     // If the video writer is active, release its resources
     if (m_video_writer) {
         if (m_video_writer->isOpened()) { m_video_writer->release(); }
-        m_video_writer.release();
+        m_video_writer.reset();
+    }
+    m_raw_writer.reset();
+    m_timestamps.reset();
+    if (m_written || m_dropped) {
+        log() << "Recorded " << m_written << " frames, dropped " << m_dropped;
     }
-    m_recording = false;
 }
 
-void Recorder::frame_received(const cv::UMat &img) {
-    // Write the frame if recording
-    if (m_recording && m_video_writer) {
+void Recorder::frame_received(const cv::UMat &img, const FrameInfo &info) {
+    // Runs on the sender's thread; queue the frame and wake the recorder
+    if (!m_recording) { return; }
+    if (!m_queue->push(queued_frame(img, info))) { ++m_dropped; }
+    schedule();
+}
+
+void Recorder::schedule() {
+    bool expected = false;
+    if (m_scheduled.compare_exchange_strong(expected, true)) {
+        QMetaObject::invokeMethod(this, "encode_queue", Qt::QueuedConnection);
+    }
+}
+
+void Recorder::encode_queue() {
+    // Clear the flag first so that a frame pushed while
+    // writing posts another call
+    m_scheduled = false;
+    queued_frame frame;
+    while (m_queue->pop(frame)) {
+        write_frame(frame.first, frame.second);
+    }
+}
+
+void Recorder::write_frame(const cv::UMat &img, const FrameInfo &info) {
+    pipeline_clock::time_point start = pipeline_clock::now();
+    // Record the capture time of the frame, or now if it is unknown
+    pipeline_clock::time_point captured = info.seq ? info.captured : start;
+    if (m_written == 0) { m_first_frame = captured; }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(captured - m_first_frame).count();
+    bool written = false;
+    if (m_raw_writer) {
+        if (!m_raw_writer->is_open() && !m_raw_writer->open(m_raw_file, img.size(), img.type())) {
+            // Opening again would truncate the file for every frame
+            log() << "Failed to open " << m_raw_file << ", recording stopped";
+            m_raw_writer.reset();
+            m_recording = false;
+        } else {
+            written = m_raw_writer->write(img, us, info.seq);
+        }
+    } else if (m_video_writer && m_video_writer->isOpened()) {
         m_video_writer->write(img.getMat(cv::ACCESS_READ));
+        if (m_timestamps) {
+            m_timestamps->write(QByteArray::number(static_cast<qint64>(us)).append('\n'));
+        }
+        written = true;
+    }
+    if (written) {
+        ++m_written;
+        PipelineStats::get().record_since(PipelineStats::RECORD, start);
+    } else {
+        ++m_dropped;
     }
 }
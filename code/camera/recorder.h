@@ -2,17 +2,35 @@
 #define MINOTAUR_CPP_RECORDER_H
 
 #include <QObject>
+#include <atomic>
 #include <memory>
+#include <utility>
+
+#include "frameinfo.h"
 
 // OpenCV forward declarations
 namespace cv {
     class UMat;
     class VideoWriter;
 }
+template<typename val_t> class ring_buffer;
+class QFile;
+class RawVideoWriter;
 
 /**
- * This class handles a cv::VideoWriter instance that is used to
- * write preprocessed cv::Mat objects to a video file.
+ * This class writes captured frames to a video file, either encoded as
+ * MJPG with a cv::VideoWriter or uncompressed into a memory-mapped raw
+ * container, chosen by the file extension.
+ *
+ * Frames are pushed into a bounded queue on the sending thread and
+ * written on the recorder thread, so a slow encoder never holds up the
+ * pipeline and never queues more than ENCODE_QUEUE_DEPTH frames. Frames
+ * arriving while the queue is full are dropped and counted.
+ *
+ * The capture time of each written frame is saved as well: inside the raw
+ * container, or alongside an MJPG video one line per frame in microseconds
+ * since the first frame, so that the ReplayCamera can play the recording
+ * back with its original timing.
  */
 class Recorder : public QObject {
 Q_OBJECT
@@ -20,7 +38,9 @@ Q_OBJECT
 public:
     enum {
         // Hard value for frame rate writing
-        DEFAULT_FRAME_RATE = 30
+        DEFAULT_FRAME_RATE = 30,
+        // Maximum number of frames waiting to be written
+        ENCODE_QUEUE_DEPTH = 8
     };
 
     explicit Recorder(
@@ -28,9 +48,12 @@ public:
         bool color = true
     );
 
+    ~Recorder() override;
+
     /**
      * Tell the recorder to start capturing video from
-     * its stream, given by Qt signals.
+     * its stream, given by Qt signals. Files with the raw
+     * video extension are recorded uncompressed.
      *
      * @param file   the file name to save to
      * @param width  the width of the video
@@ -40,29 +63,85 @@ public:
 
     /**
      * Tell the recorder to stop recording video from the
-     * signal stream. The file will be closed.
+     * signal stream. Queued frames are written and the
+     * file is closed.
      */
     Q_SLOT void stop_recording();
 
     /**
-     * Slot called with a processed frame that is written to the video
-     * file, if the recorder is active.
+     * Slot called with a frame to write to the video file, if the
+     * recorder is active. This slot should be connected with
+     * Qt::DirectConnection so that the frame is queued on the
+     * sender's thread.
      *
-     * @param img frame image
+     * @param img  frame image
+     * @param info frame sequence number and timestamp
      */
-    Q_SLOT void frame_received(const cv::UMat &img);
+    Q_SLOT void frame_received(const cv::UMat &img, const FrameInfo &info = FrameInfo());
 
     bool is_recording() const;
 
+    /**
+     * @return number of frames written to the current or last recording
+     */
+    std::size_t frames_written() const;
+
+    /**
+     * @return number of frames dropped from the current or last recording
+     */
+    std::size_t frames_dropped() const;
+
 private:
+    typedef std::pair<cv::UMat, FrameInfo> queued_frame;
+    typedef ring_buffer<queued_frame> frame_ring;
+
+    /**
+     * Write all queued frames. Runs on the recorder thread.
+     */
+    Q_SLOT void encode_queue();
+
+    /**
+     * Post a single encode_queue() call to the recorder thread.
+     */
+    void schedule();
+
+    /**
+     * Write a frame to the open video.
+     */
+    void write_frame(const cv::UMat &img, const FrameInfo &info);
+
     /**
      * Handle video writer.
      */
     std::unique_ptr<cv::VideoWriter> m_video_writer;
+    /**
+     * Raw video writer, opened with the first frame.
+     */
+    std::unique_ptr<RawVideoWriter> m_raw_writer;
+    QString m_raw_file;
+    /**
+     * Frame timestamps file written next to an MJPG video.
+     */
+    std::unique_ptr<QFile> m_timestamps;
+    /**
+     * Capture time of the first recorded frame.
+     */
+    pipeline_clock::time_point m_first_frame;
+
+    /**
+     * Frames waiting to be written.
+     */
+    std::unique_ptr<frame_ring> m_queue;
+    std::atomic<bool> m_scheduled;
+    /**
+     * Frames dropped because the queue was full or could not be written.
+     */
+    std::atomic<std::size_t> m_dropped;
+    std::atomic<std::size_t> m_written;
 
     int m_frame_rate;
     bool m_color;
-    bool m_recording;
+    std::atomic<bool> m_recording;
 };
 
 #endif //MINOTAUR_CPP_RECORDER_H
@@ -0,0 +1,184 @@
+#include <QFile>
+#include <QTextStream>
+
+#include "rawvideo.h"
+#include "replaycamera.h"
+#include "../utility/logger.h"
+#include "../utility/utility.h"
+
+ReplayCamera::ReplayCamera(const QString &filename, Mode mode) :
+    m_raw_pos(0),
+    m_frame_period(1000000 / DEFAULT_FRAME_RATE),
+    m_mode(mode),
+    m_next(0),
+    // Show the first frame straight away when stepping
+    m_steps(1) {
+    open(filename.toStdString());
+}
+
+ReplayCamera::~ReplayCamera() = default;
+
+QString ReplayCamera::timestamps_file(const QString &video_file) {
+    return video_file + ".ts";
+}
+
+ReplayCamera::Mode ReplayCamera::mode() const {
+    return m_mode;
+}
+
+bool ReplayCamera::frame_due() const {
+    switch (m_mode) {
+        case REALTIME:
+            // The clock starts with the first frame
+            return m_next == 0 || pipeline_clock::now() >= due_time(m_next);
+        case STEP:
+            return m_steps > 0;
+        default:
+            return true;
+    }
+}
+
+void ReplayCamera::step(int frames) {
+    m_steps += frames;
+}
+
+bool ReplayCamera::open(const cv::String &filename) {
+    m_timestamps.clear();
+    m_next = 0;
+    m_raw_pos = 0;
+    QString file = QString::fromStdString(filename);
+    if (rawvideo::is_raw_file(file)) {
+        m_raw = std::make_unique<RawVideoReader>();
+        if (!m_raw->open(file)) { return false; }
+        m_timestamps.reserve(m_raw->frames());
+        for (std::size_t i = 0; i < m_raw->frames(); ++i) {
+            m_timestamps.push_back(m_raw->timestamp(i));
+        }
+        log() << "Replaying " << file << " with " << m_raw->frames() << " raw frames";
+        return true;
+    }
+    m_raw.reset();
+    if (!m_video.open(filename)) { return false; }
+    double fps = m_video.get(cv::CAP_PROP_FPS);
+    if (fps > 0) { m_frame_period = static_cast<std::int64_t>(1000000 / fps); }
+    // Load the recorded frame times, if there are any
+    QFile timestamps(timestamps_file(file));
+    if (timestamps.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&timestamps);
+        while (!in.atEnd()) {
+            bool ok = false;
+            qint64 us = in.readLine().toLongLong(&ok);
+            if (ok) { m_timestamps.push_back(us); }
+        }
+    }
+    log() << "Replaying " << file << " with "
+          << m_timestamps.size() << " recorded timestamps";
+    return true;
+}
+
+bool ReplayCamera::open(const cv::String &filename, int) {
+    return open(filename);
+}
+
+bool ReplayCamera::open(int) {
+    return false;
+}
+
+bool ReplayCamera::isOpened() const {
+    return m_raw ? m_raw->is_open() : m_video.isOpened();
+}
+
+void ReplayCamera::release() {
+    if (m_raw) { m_raw->close(); }
+    m_video.release();
+}
+
+bool ReplayCamera::grab() {
+    // Grabbing and retrieving separately is only needed for
+    // synchronizing multiple cameras, which replays do not do
+    return false;
+}
+
+bool ReplayCamera::retrieve(cv::OutputArray, int) {
+    return false;
+}
+
+cv::VideoCapture &ReplayCamera::operator>>(cv::Mat &image) {
+    read(image);
+    return *this;
+}
+
+cv::VideoCapture &ReplayCamera::operator>>(cv::UMat &image) {
+    read(image);
+    return *this;
+}
+
+bool ReplayCamera::read(cv::OutputArray image) {
+    advance();
+    return read_frame(image);
+}
+
+bool ReplayCamera::set(int prop_id, double value) {
+    return m_raw ? false : m_video.set(prop_id, value);
+}
+
+double ReplayCamera::get(int prop_id) const {
+    if (!m_raw) { return m_video.get(prop_id); }
+    switch (prop_id) {
+        case cv::CAP_PROP_FRAME_WIDTH:
+            return m_raw->size().width;
+        case cv::CAP_PROP_FRAME_HEIGHT:
+            return m_raw->size().height;
+        case cv::CAP_PROP_FRAME_COUNT:
+            return m_raw->frames();
+        case cv::CAP_PROP_POS_FRAMES:
+            return m_raw_pos;
+        default:
+            return 0;
+    }
+}
+
+bool ReplayCamera::skip_frame() {
+    if (!m_raw) { return m_video.grab(); }
+    if (m_raw_pos >= m_raw->frames()) { return false; }
+    ++m_raw_pos;
+    return true;
+}
+
+bool ReplayCamera::read_frame(cv::OutputArray image) {
+    if (!m_raw) { return m_video.read(image); }
+    if (m_raw_pos >= m_raw->frames()) {
+        image.release();
+        return false;
+    }
+    // Copy out of the mapped file, which the frame must not outlive
+    m_raw->frame(m_raw_pos++).copyTo(image);
+    return true;
+}
+
+std::int64_t ReplayCamera::timestamp(std::size_t index) const {
+    if (index < m_timestamps.size()) { return m_timestamps[index]; }
+    // Extrapolate past the recorded timestamps
+    std::int64_t last = m_timestamps.empty() ? 0 : m_timestamps.back();
+    std::size_t first = m_timestamps.empty() ? 0 : m_timestamps.size() - 1;
+    return last + static_cast<std::int64_t>(index - first) * m_frame_period;
+}
+
+pipeline_clock::time_point ReplayCamera::due_time(std::size_t index) const {
+    return m_start + std::chrono::microseconds(timestamp(index) - timestamp(0));
+}
+
+void ReplayCamera::advance() {
+    if (m_mode == REALTIME) {
+        if (m_next == 0) {
+            m_start = pipeline_clock::now();
+        } else {
+            // Skip frames that a live camera would have replaced by now
+            pipeline_clock::time_point now = pipeline_clock::now();
+            while (due_time(m_next + 1) <= now && skip_frame()) { ++m_next; }
+        }
+    } else if (m_mode == STEP && m_steps > 0) {
+        --m_steps;
+    }
+    ++m_next;
+}
@@ -0,0 +1,157 @@
+#ifndef MINOTAUR_CPP_REPLAYCAMERA_H
+#define MINOTAUR_CPP_REPLAYCAMERA_H
+
+#include <opencv2/videoio.hpp>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "frameinfo.h"
+
+// Forward declarations
+class RawVideoReader;
+
+/**
+ * VideoCapture that plays back a recording made by the Recorder, so
+ * that trackers and procedures can be run on recorded footage.
+ *
+ * Both MJPG videos and raw recordings are supported. Raw recordings carry
+ * their own timestamps, while those of a video are read from the file
+ * written by the Recorder next to it. If there is none, frames are assumed
+ * to be evenly spaced at the frame rate of the video.
+ *
+ * The Capture asks frame_due() before pulling each frame, which lets the
+ * camera pace playback without blocking the capture thread.
+ */
+class ReplayCamera : public cv::VideoCapture {
+public:
+    enum {
+        // Frame rate assumed when the video does not report one
+        DEFAULT_FRAME_RATE = 30
+    };
+
+    enum Mode {
+        // Frames are produced at their recorded times, and frames that
+        // a live camera would have replaced by then are skipped
+        REALTIME = 0,
+        // Frames are produced as fast as they are pulled
+        MAX_SPEED = 1,
+        // Frames are produced one at a time when step() is called
+        STEP = 2
+    };
+
+    /**
+     * @param filename path to the recorded video
+     * @param mode     playback mode
+     */
+    ReplayCamera(const QString &filename, Mode mode);
+
+    ~ReplayCamera() override;
+
+    /**
+     * @param video_file path to a recorded video
+     * @return path of the timestamps file recorded with the video
+     */
+    static QString timestamps_file(const QString &video_file);
+
+    Mode mode() const;
+
+    /**
+     * @return whether the next frame should be pulled now
+     */
+    bool frame_due() const;
+
+    /**
+     * Allow the given number of frames to be pulled in STEP mode.
+     *
+     * @param frames number of frames to advance
+     */
+    void step(int frames = 1);
+
+    bool open(const cv::String &filename) override;
+    bool open(const cv::String &filename, int api_pref) override;
+    bool open(int index) override;
+
+    bool isOpened() const override;
+    void release() override;
+
+    bool grab() override;
+    bool retrieve(cv::OutputArray image, int flag) override;
+
+    cv::VideoCapture& operator>>(cv::Mat &image) override;
+    cv::VideoCapture& operator>>(cv::UMat &image) override;
+
+    bool read(cv::OutputArray image) override;
+    bool set(int prop_id, double value) override;
+    double get(int prop_id) const override;
+
+private:
+    /**
+     * @param index frame index
+     * @return recorded time of the frame relative to the first frame
+     */
+    std::int64_t timestamp(std::size_t index) const;
+
+    /**
+     * @param index frame index
+     * @return time at which the frame should be produced in REALTIME mode
+     */
+    pipeline_clock::time_point due_time(std::size_t index) const;
+
+    /**
+     * Prepare to pull the next frame, skipping late frames in REALTIME mode.
+     */
+    void advance();
+
+    /**
+     * Discard the next frame.
+     *
+     * @return false at the end of the recording
+     */
+    bool skip_frame();
+
+    /**
+     * Read the next frame, or an empty one at the end of the recording.
+     *
+     * @return false at the end of the recording
+     */
+    bool read_frame(cv::OutputArray image);
+
+    /**
+     * Decoder of a recorded video.
+     */
+    cv::VideoCapture m_video;
+    /**
+     * Reader of a raw recording, used instead of the decoder.
+     */
+    std::unique_ptr<RawVideoReader> m_raw;
+    /**
+     * Index of the next frame to read from the raw recording.
+     */
+    std::size_t m_raw_pos;
+    /**
+     * Recorded frame times, in microseconds since the first frame.
+     */
+    std::vector<std::int64_t> m_timestamps;
+    /**
+     * Time between frames, in microseconds, past the recorded timestamps.
+     */
+    std::int64_t m_frame_period;
+
+    Mode m_mode;
+    /**
+     * Index of the next frame to be pulled.
+     */
+    std::size_t m_next;
+    /**
+     * Time at which the first frame was produced.
+     */
+    pipeline_clock::time_point m_start;
+    /**
+     * Number of frames that may still be pulled in STEP mode.
+     */
+    int m_steps;
+};
+
+#endif //MINOTAUR_CPP_REPLAYCAMERA_H
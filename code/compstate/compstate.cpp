@@ -3,12 +3,15 @@
 #include "parammanager.h"
 #include "procedure.h"
 
+#include "../camera/calibration.h"
 #include "../camera/statusbox.h"
 #include "../camera/statuslabel.h"
 #include "../gui/global.h"
 #include "../utility/logger.h"
 #include "../utility/utility.h"
 #include "../utility/vector.h"
+#include "../video/boxfilter.h"
+#include "../video/flowvelocity.h"
 
 #include <opencv2/core/types.hpp>
 
@@ -17,38 +20,87 @@
 #include <QDebug>
 #endif
 
-/**
- * Determine the likelihood that a bounding box actually contains the
- * object or robot that is tracked, based on the squareness of the rectangle
- * and its closeness to the calibrated area.
- *
- * Based off formula in
- * https://users.cs.cf.ac.uk/Paul.Rosin/resources/papers/squareness-JMIV-postprint.pdf
- *
- * @param rect            bounding box rectangle
- * @param calibrated_area the expected area of the object or robot
- * @return a value representing accuracy
- */
-static double acquisition_r(const cv::Rect2d &rect, double calibrated_area) {
-    double area = rect.width * rect.height;
-    if (!area) { return 1000; }
-    double t = rect.width > rect.height
-               ? rect.width / rect.height
-               : rect.height / rect.width;
-    if (t <= 0.99) { return 1000; }
-    return fabs(area - calibrated_area) / (area > calibrated_area ? area : calibrated_area) * t;
-}
-
 static QString center_text(const cv::Rect2d &rect, const char *label) {
     QString text;
     text.sprintf("%6s: (%6.1f , %6.1f )", label, rect.x + rect.width / 2, rect.y + rect.height / 2);
     return text;
 }
 
+/**
+ * Map a box found in a raw frame to field units with the installed
+ * calibration. Without a calibration, field units are raw pixels.
+ */
+static cv::Rect2d field_box(const cv::Rect2d &raw, const cv::Size &frame) {
+    std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current();
+    if (!calibration || raw.area() <= 0) { return raw; }
+    return calibration->raw_to_field(raw, frame);
+}
+
+/**
+ * Map filtered motion in raw pixels to field units. The velocity and
+ * covariance are carried through the local derivative of the map at
+ * the box center.
+ */
+static TargetMotion field_motion(const TargetMotion &raw, const cv::Size &frame) {
+    std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current();
+    if (!calibration || !raw.valid) { return raw; }
+    cv::Point2d center(raw.box.x + raw.box.width / 2, raw.box.y + raw.box.height / 2);
+    cv::Matx22d j = calibration->raw_to_field_jacobian(center, frame);
+    TargetMotion motion = raw;
+    motion.box = calibration->raw_to_field(raw.box, frame);
+    motion.velocity = j * raw.velocity;
+    motion.covariance = j * raw.covariance * j.t();
+    return motion;
+}
+
+/**
+ * Map optical flow in raw pixels to field units through the local
+ * derivative of the map at the target.
+ */
+static TargetFlow field_flow(const TargetFlow &raw, const cv::Size &frame) {
+    std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current();
+    if (!calibration || !raw.valid) { return raw; }
+    cv::Matx22d j = calibration->raw_to_field_jacobian(raw.position, frame);
+    TargetFlow flow = raw;
+    flow.position = calibration->raw_to_field(raw.position, frame);
+    flow.displacement = j * raw.displacement;
+    flow.velocity = j * raw.velocity;
+    return flow;
+}
+
+static cv::Point2d field_point(const cv::Point2d &raw, const cv::Size &frame) {
+    std::shared_ptr<const CameraCalibration> calibration = CameraCalibration::current();
+    if (!calibration) { return raw; }
+    return calibration->raw_to_field(raw, frame);
+}
+
+static vector2d box_center(const cv::Rect2d &box, bool refined, const cv::Point2d &center) {
+    if (refined) { return {center.x, center.y}; }
+    return {box.x + box.width / 2, box.y + box.height / 2};
+}
+
 struct CompetitionState::Impl {
+    Impl() :
+        center_robot_refined(false),
+        center_object_refined(false) {}
+
     cv::Rect2d box_robot;
     cv::Rect2d box_object;
     cv::Rect2d box_target;
+    // Boxes in raw frame pixels, the units of the calibrated areas
+    cv::Rect2d raw_box_robot;
+    cv::Rect2d raw_box_object;
+    // Refined centers, which hold only for the box they were measured with
+    cv::Point2d center_robot;
+    cv::Point2d center_object;
+    bool center_robot_refined;
+    bool center_object_refined;
+    TargetMotion motion_robot;
+    TargetMotion motion_object;
+    TargetFlow flow_robot;
+    TargetFlow flow_object;
+    // Size of the frames boxes are found in
+    cv::Size frame_size;
 };
 
 CompetitionState::CompetitionState(MainWindow *parent) :
@@ -57,6 +109,10 @@ CompetitionState::CompetitionState(MainWindow *parent) :
     m_tracking_robot(false),
     m_tracking_object(false),
     m_acquire_walls(false),
+    m_robot_box_fresh(false),
+    m_object_box_fresh(false),
+    m_robot_box_reused(false),
+    m_object_box_reused(false),
     m_object_type(UNACQUIRED) {
     if (auto lp = parent->status_box().lock()) {
         m_robot_loc_label = lp->add_label(center_text(cv::Rect2d(), "Robot"));
@@ -70,26 +126,77 @@ void CompetitionState::acquire_robot_box(const cv::Rect2d &robot_box) {
 #ifndef NDEBUG
     assert(m_robot_loc_label != nullptr);
 #endif
-    m_robot_loc_label->setText(center_text(robot_box, "Robot"));
-    m_impl->box_robot = robot_box;
+    m_impl->raw_box_robot = robot_box;
+    m_impl->box_robot = field_box(robot_box, m_impl->frame_size);
+    m_impl->center_robot_refined = false;
+    m_robot_loc_label->setText(center_text(m_impl->box_robot, "Robot"));
     m_robot_box_fresh = true;
+    m_robot_box_reused = false;
 }
 
 void CompetitionState::acquire_object_box(const cv::Rect2d &object_box) {
 #ifndef NDEBUG
     assert(m_object_loc_label != nullptr);
 #endif
-    m_object_loc_label->setText(center_text(object_box, "Object"));
-    m_impl->box_object = object_box;
+    m_impl->raw_box_object = object_box;
+    m_impl->box_object = field_box(object_box, m_impl->frame_size);
+    m_impl->center_object_refined = false;
+    m_object_loc_label->setText(center_text(m_impl->box_object, "Object"));
+    m_object_box_fresh = true;
+    m_object_box_reused = false;
+}
+
+void CompetitionState::confirm_robot_box() {
+    m_robot_box_fresh = true;
+    m_robot_box_reused = true;
+}
+
+void CompetitionState::confirm_object_box() {
     m_object_box_fresh = true;
+    m_object_box_reused = true;
 }
 
 void CompetitionState::acquire_target_box(const cv::Rect2d &target_box) {
-    m_impl->box_target = target_box;
+    m_impl->box_target = field_box(target_box, m_impl->frame_size);
+}
+
+void CompetitionState::acquire_robot_center(const cv::Point2d &robot_center) {
+    m_impl->center_robot = field_point(robot_center, m_impl->frame_size);
+    m_impl->center_robot_refined = true;
+}
+
+void CompetitionState::acquire_object_center(const cv::Point2d &object_center) {
+    m_impl->center_object = field_point(object_center, m_impl->frame_size);
+    m_impl->center_object_refined = true;
+}
+
+void CompetitionState::acquire_robot_motion(const TargetMotion &robot_motion) {
+    m_impl->motion_robot = field_motion(robot_motion, m_impl->frame_size);
 }
 
-void CompetitionState::acquire_walls(std::shared_ptr<wall_arr> &walls) {
+void CompetitionState::acquire_object_motion(const TargetMotion &object_motion) {
+    m_impl->motion_object = field_motion(object_motion, m_impl->frame_size);
+}
+
+void CompetitionState::acquire_robot_flow(const TargetFlow &robot_flow) {
+    m_impl->flow_robot = field_flow(robot_flow, m_impl->frame_size);
+}
+
+void CompetitionState::acquire_object_flow(const TargetFlow &object_flow) {
+    m_impl->flow_object = field_flow(object_flow, m_impl->frame_size);
+}
+
+void CompetitionState::acquire_frame_size(const cv::Size &frame_size) {
+    m_impl->frame_size = frame_size;
+}
+
+void CompetitionState::acquire_walls(const std::shared_ptr<wall_arr> &walls) {
     m_walls = walls;
+    Q_EMIT walls_changed();
+}
+
+std::shared_ptr<CompetitionState::wall_arr> CompetitionState::get_walls() const {
+    return m_walls;
 }
 
 bool CompetitionState::is_tracking_robot() const {
@@ -130,6 +237,38 @@ cv::Rect2d &CompetitionState::get_target_box() {
     return m_impl->box_target;
 }
 
+void CompetitionState::consume_robot_box() {
+    m_robot_box_fresh = false;
+}
+
+void CompetitionState::consume_object_box() {
+    m_object_box_fresh = false;
+}
+
+vector2d CompetitionState::get_robot_center() const {
+    return box_center(m_impl->box_robot, m_impl->center_robot_refined, m_impl->center_robot);
+}
+
+vector2d CompetitionState::get_object_center() const {
+    return box_center(m_impl->box_object, m_impl->center_object_refined, m_impl->center_object);
+}
+
+const TargetMotion &CompetitionState::get_robot_motion() const {
+    return m_impl->motion_robot;
+}
+
+const TargetMotion &CompetitionState::get_object_motion() const {
+    return m_impl->motion_object;
+}
+
+const TargetFlow &CompetitionState::get_robot_flow() const {
+    return m_impl->flow_robot;
+}
+
+const TargetFlow &CompetitionState::get_object_flow() const {
+    return m_impl->flow_object;
+}
+
 bool CompetitionState::is_robot_box_fresh() const {
     return m_robot_box_fresh;
 }
@@ -138,16 +277,35 @@ bool CompetitionState::is_object_box_fresh() const {
     return m_object_box_fresh;
 }
 
+bool CompetitionState::is_robot_box_reused() const {
+    return m_robot_box_reused;
+}
+
+bool CompetitionState::is_object_box_reused() const {
+    return m_object_box_reused;
+}
+
+double CompetitionState::acquisition_r(const cv::Rect2d &rect, double calibrated_area) {
+    double area = rect.width * rect.height;
+    if (!area) { return 1000; }
+    double t = rect.width > rect.height
+               ? rect.width / rect.height
+               : rect.height / rect.width;
+    if (t <= 0.99) { return 1000; }
+    return fabs(area - calibrated_area) / (area > calibrated_area ? area : calibrated_area) * t;
+}
+
 bool CompetitionState::is_robot_box_valid() const {
-    return acquisition_r(m_impl->box_robot, g_pm->robot_calib_area) < g_pm->area_acq_r_sigma;
+    return acquisition_r(m_impl->raw_box_robot, g_pm->robot_calib_area) < g_pm->area_acq_r_sigma;
 }
 
 bool CompetitionState::is_object_box_valid() const {
-    return acquisition_r(m_impl->box_object, g_pm->object_calib_area) < g_pm->area_acq_r_sigma;
+    return acquisition_r(m_impl->raw_box_object, g_pm->object_calib_area) < g_pm->area_acq_r_sigma;
 }
 
 void CompetitionState::clear_path() {
     m_path.clear();
+    Q_EMIT path_changed();
 }
 
 void CompetitionState::append_path(double x, double y) {
@@ -155,6 +313,7 @@ void CompetitionState::append_path(double x, double y) {
     qDebug() << '(' << x << ',' << ' ' << y << ')';
 #endif
     m_path.emplace_back(x, y);
+    Q_EMIT path_changed();
 }
 
 const path2d &CompetitionState::get_path() const {
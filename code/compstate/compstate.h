@@ -9,6 +9,10 @@
 namespace cv {
     template<typename _Tp> class Rect_;
     typedef Rect_<double> Rect2d;
+    template<typename _Tp> class Point_;
+    typedef Point_<double> Point2d;
+    template<typename _Tp> class Size_;
+    typedef Size_<int> Size;
 }
 namespace nrg {
     template<typename val_t> class vector;
@@ -18,6 +22,9 @@ class MainWindow;
 class StatusLabel;
 class Procedure;
 class ObjectProcedure;
+struct TargetMotion;
+struct TargetFlow;
+typedef nrg::vector<double> vector2d;
 typedef std::vector<nrg::vector<double>> path2d;
 
 /**
@@ -25,6 +32,11 @@ typedef std::vector<nrg::vector<double>> path2d;
  * for communication between various object instances that contribute to
  * running the robot and object at competition time.
  *
+ * Boxes, motion and the path are held in field units. Boxes and motion
+ * are found in raw frame pixels and are mapped to field units with the
+ * installed CameraCalibration as they are acquired; without one, field
+ * units are raw pixels.
+ *
  * The global instance is held in the MainWindow.
  */
 class CompetitionState : public QObject {
@@ -60,11 +72,44 @@ public:
     Q_SLOT void acquire_robot_box(const cv::Rect2d &robot_box);
     Q_SLOT void acquire_object_box(const cv::Rect2d &object_box);
     Q_SLOT void acquire_target_box(const cv::Rect2d &target_box);
-    Q_SLOT void acquire_walls(std::shared_ptr<wall_arr> &walls);
+    /**
+     * Subpixel centroid of the robot or object, measured in the same
+     * frame as the last acquired box, which it refines.
+     */
+    Q_SLOT void acquire_robot_center(const cv::Point2d &robot_center);
+    Q_SLOT void acquire_object_center(const cv::Point2d &object_center);
+    /**
+     * The last robot or object box still holds, for a frame that was
+     * unchanged from the one the box was found in. The box becomes fresh
+     * again without a new measurement, and is marked as reused.
+     */
+    Q_SLOT void confirm_robot_box();
+    Q_SLOT void confirm_object_box();
+
+    Q_SLOT void acquire_robot_motion(const TargetMotion &robot_motion);
+    Q_SLOT void acquire_object_motion(const TargetMotion &object_motion);
+    Q_SLOT void acquire_robot_flow(const TargetFlow &robot_flow);
+    Q_SLOT void acquire_object_flow(const TargetFlow &object_flow);
+    /**
+     * Size of the frames the boxes, centers, motion and flow are found in,
+     * which the calibration maps from.
+     */
+    Q_SLOT void acquire_frame_size(const cv::Size &frame_size);
+    Q_SLOT void acquire_walls(const std::shared_ptr<wall_arr> &walls);
+
+    /**
+     * Emitted when a new wall grid is acquired.
+     */
+    Q_SIGNAL void walls_changed();
 
     Q_SLOT void clear_path();
     Q_SLOT void append_path(double x, double y);
 
+    /**
+     * Emitted when the path is cleared or a node is appended.
+     */
+    Q_SIGNAL void path_changed();
+
     Q_SLOT void begin_traversal();
     Q_SLOT void halt_traversal();
 
@@ -73,10 +118,45 @@ public:
 
     const path2d &get_path() const;
 
+    /**
+     * @return the last acquired wall grid, indexed by cell column
+     *         then row, or nullptr if none has been acquired
+     */
+    std::shared_ptr<wall_arr> get_walls() const;
+
     cv::Rect2d &get_robot_box(bool consume = false);
     cv::Rect2d &get_object_box(bool consume = false);
     cv::Rect2d &get_target_box();
 
+    /**
+     * Mark the robot or object box as used, so that it is not fresh
+     * until the next one is acquired or confirmed.
+     */
+    void consume_robot_box();
+    void consume_object_box();
+
+    /**
+     * @return the subpixel centroid of the last robot or object box,
+     *         or the center of the box if it was not refined
+     */
+    vector2d get_robot_center() const;
+    vector2d get_object_center() const;
+
+    /**
+     * Filtered motion of the robot and object, from which their
+     * boxes can be predicted between frames.
+     */
+    const TargetMotion &get_robot_motion() const;
+    const TargetMotion &get_object_motion() const;
+
+    /**
+     * Displacement and velocity of the robot and object measured by
+     * optical flow between their last two frames, with the time of the
+     * later frame. Free of the jitter of the boxes.
+     */
+    const TargetFlow &get_robot_flow() const;
+    const TargetFlow &get_object_flow() const;
+
     bool is_tracking_robot() const;
     void set_tracking_robot(bool tracking_robot);
 
@@ -89,9 +169,34 @@ public:
     bool is_robot_box_fresh() const;
     bool is_object_box_fresh() const;
 
+    /**
+     * @return whether the fresh box was confirmed from an unchanged
+     *         frame rather than measured in a new one
+     */
+    bool is_robot_box_reused() const;
+    bool is_object_box_reused() const;
+
+    /**
+     * @return whether the last robot or object box, in raw frame
+     *         pixels, is close enough to the calibrated area
+     */
     bool is_robot_box_valid() const;
     bool is_object_box_valid() const;
 
+    /**
+     * Determine the likelihood that a bounding box actually contains the
+     * object or robot that is tracked, based on the squareness of the rectangle
+     * and its closeness to the calibrated area.
+     *
+     * Based off formula in
+     * https://users.cs.cf.ac.uk/Paul.Rosin/resources/papers/squareness-JMIV-postprint.pdf
+     *
+     * @param rect            bounding box rectangle
+     * @param calibrated_area the expected area of the object or robot
+     * @return a value representing accuracy, lower is better
+     */
+    static double acquisition_r(const cv::Rect2d &rect, double calibrated_area);
+
 private:
     // Pointer to MainWindow parent
     MainWindow *m_parent;
@@ -113,6 +218,8 @@ private:
     // from the trackers has been consumed by a procedure
     bool m_robot_box_fresh;
     bool m_object_box_fresh;
+    bool m_robot_box_reused;
+    bool m_object_box_reused;
 
     std::shared_ptr<wall_arr> m_walls;
 
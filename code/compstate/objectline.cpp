@@ -201,7 +201,8 @@ void ObjectLine::do_doing_object_move() {
 void ObjectLine::do_require_correction() {
     // Determine the correction direction
     CompetitionState &state = Main::get()->state();
-    vector2d obj_loc = rect2d(state.get_object_box(true)).center();
+    state.consume_object_box();
+    vector2d obj_loc = state.get_object_center();
     switch (m_impl->dir) {
         case nrg::dir::RIGHT:
         case nrg::dir::LEFT:
@@ -153,10 +153,10 @@ void ObjectMove::movement_loop() {
         ) {
         return;
     }
-    rect2d rob = state.get_robot_box(true);
-    rect2d obj = state.get_object_box(true);
-    vector2d obj_loc = obj.center();
-    vector2d rob_loc = rob.center();
+    state.consume_robot_box();
+    state.consume_object_box();
+    vector2d obj_loc = state.get_object_center();
+    vector2d rob_loc = state.get_robot_center();
     // Check if the object has passed the target threshold
     // and that the robot is on the correct side of the object
     m_stop = Stop::OKAY;
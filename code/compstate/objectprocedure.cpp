@@ -103,7 +103,8 @@ void ObjectProcedure::movement_loop() {
     if (!m_start) {
         m_start = true;
         path2d path;
-        vector2d object_loc = rect2d(state.get_object_box(true)).center();
+        state.consume_object_box();
+        vector2d object_loc = state.get_object_center();
         path.push_back(object_loc);
         path.insert(path.end(), m_impl->path.begin(), m_impl->path.end());
         m_impl->path = std::move(path);
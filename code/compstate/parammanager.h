@@ -50,7 +50,7 @@ Q_OBJECT
     parent_t m_p;
 
 public:
-    // CompetitionState
+    // CompetitionState, areas in raw frame pixels
     MANAGE_PARAM(double,  robot_calib_area, 400.0)
     MANAGE_PARAM(double, object_calib_area, 400.0)
     MANAGE_PARAM(double,  area_acq_r_sigma,  1.34)
@@ -70,6 +70,54 @@ public:
     MANAGE_PARAM(int, wall_penalty_1,  16)
     MANAGE_PARAM(int, wall_penalty_2,   4)
 
+    // BlobDetect, hue in [0, 180)
+    MANAGE_PARAM(int,  robot_hue_min,  35)
+    MANAGE_PARAM(int,  robot_hue_max,  65)
+    MANAGE_PARAM(int, object_hue_min,   5)
+    MANAGE_PARAM(int, object_hue_max,  30)
+    MANAGE_PARAM(int,   blob_sat_min, 100)
+    MANAGE_PARAM(int,   blob_val_min, 100)
+
+    // WallDetect, gray levels of wall pixels and the fraction of a cell
+    // they must fill, and the mean gray change that reclassifies a cell
+    MANAGE_PARAM(int,    wall_gray_min,    0)
+    MANAGE_PARAM(int,    wall_gray_max,   60)
+    MANAGE_PARAM(double, wall_cell_fill,   0.5)
+    MANAGE_PARAM(double, wall_cell_change, 8.0)
+
+    // Capture, applied when a camera is started
+    MANAGE_PARAM(int, capture_width,    0)
+    MANAGE_PARAM(int, capture_height,   0)
+    MANAGE_PARAM(int, capture_fps,      0)
+    MANAGE_PARAM(int, capture_blocking, 1)
+
+    // Recorder, 1 to record captured frames instead of the processed
+    // ones, without overlays, rotation or zoom, for replays
+    MANAGE_PARAM(int, record_captured, 0)
+
+    // Tracker, -1 for the build default, otherwise a __tracker::Type
+    MANAGE_PARAM(int, tracker_type, -1)
+    // 1 to refine robot and object centers to subpixel centroids
+    MANAGE_PARAM(int, centroid_refine, 1)
+
+    // Preprocessor
+    MANAGE_PARAM(int, frame_queue_depth,  1)
+    MANAGE_PARAM(int, frame_queue_policy, 0)
+    MANAGE_PARAM(double, analysis_scale,  1.0)
+    // Block mean gray level change below which analysis is skipped, 0 to
+    // analyze every frame, and the most frames skipped in a row
+    MANAGE_PARAM(double, analysis_gate,      4.0)
+    MANAGE_PARAM(int,    analysis_max_reuse, 30)
+
+    // Calibrate, inner corners of the chessboard and the side of a
+    // square, which sets the field units
+    MANAGE_PARAM(int,    calib_board_cols,  9)
+    MANAGE_PARAM(int,    calib_board_rows,  6)
+    MANAGE_PARAM(double, calib_square_size, 25.0)
+
+    // ImageViewer, 1 to display frames with OpenGL
+    MANAGE_PARAM(int, display_opengl, 0)
+
 public:
     inline explicit param_manager(parent_t p) :
         m_p(p) {
@@ -92,6 +140,48 @@ public:
         PARAM_INIT(wall_penalty_0);
         PARAM_INIT(wall_penalty_1);
         PARAM_INIT(wall_penalty_2);
+
+        // BlobDetect
+        PARAM_INIT( robot_hue_min)
+        PARAM_INIT( robot_hue_max)
+        PARAM_INIT(object_hue_min)
+        PARAM_INIT(object_hue_max)
+        PARAM_INIT(  blob_sat_min)
+        PARAM_INIT(  blob_val_min)
+
+        // WallDetect
+        PARAM_INIT(wall_gray_min)
+        PARAM_INIT(wall_gray_max)
+        PARAM_INIT(wall_cell_fill)
+        PARAM_INIT(wall_cell_change)
+
+        // Capture
+        PARAM_INIT(capture_width)
+        PARAM_INIT(capture_height)
+        PARAM_INIT(capture_fps)
+        PARAM_INIT(capture_blocking)
+
+        // Recorder
+        PARAM_INIT(record_captured)
+
+        // Tracker
+        PARAM_INIT(tracker_type)
+        PARAM_INIT(centroid_refine)
+
+        // Preprocessor
+        PARAM_INIT(frame_queue_depth)
+        PARAM_INIT(frame_queue_policy)
+        PARAM_INIT(analysis_scale)
+        PARAM_INIT(analysis_gate)
+        PARAM_INIT(analysis_max_reuse)
+
+        // Calibrate
+        PARAM_INIT(calib_board_cols)
+        PARAM_INIT(calib_board_rows)
+        PARAM_INIT(calib_square_size)
+
+        // ImageViewer
+        PARAM_INIT(display_opengl)
     }
 
     inline ~param_manager() override {
@@ -114,6 +204,48 @@ public:
         PARAM_DEINIT(wall_penalty_0);
         PARAM_DEINIT(wall_penalty_1);
         PARAM_DEINIT(wall_penalty_2);
+
+        // BlobDetect
+        PARAM_DEINIT( robot_hue_min)
+        PARAM_DEINIT( robot_hue_max)
+        PARAM_DEINIT(object_hue_min)
+        PARAM_DEINIT(object_hue_max)
+        PARAM_DEINIT(  blob_sat_min)
+        PARAM_DEINIT(  blob_val_min)
+
+        // WallDetect
+        PARAM_DEINIT(wall_gray_min)
+        PARAM_DEINIT(wall_gray_max)
+        PARAM_DEINIT(wall_cell_fill)
+        PARAM_DEINIT(wall_cell_change)
+
+        // Capture
+        PARAM_DEINIT(capture_width)
+        PARAM_DEINIT(capture_height)
+        PARAM_DEINIT(capture_fps)
+        PARAM_DEINIT(capture_blocking)
+
+        // Recorder
+        PARAM_DEINIT(record_captured)
+
+        // Tracker
+        PARAM_DEINIT(tracker_type)
+        PARAM_DEINIT(centroid_refine)
+
+        // Preprocessor
+        PARAM_DEINIT(frame_queue_depth)
+        PARAM_DEINIT(frame_queue_policy)
+        PARAM_DEINIT(analysis_scale)
+        PARAM_DEINIT(analysis_gate)
+        PARAM_DEINIT(analysis_max_reuse)
+
+        // Calibrate
+        PARAM_DEINIT(calib_board_cols)
+        PARAM_DEINIT(calib_board_rows)
+        PARAM_DEINIT(calib_square_size)
+
+        // ImageViewer
+        PARAM_DEINIT(display_opengl)
     }
 };
 
@@ -97,7 +97,7 @@ void Procedure::start() {
     // Start the time and grab the initial robot location
     CompetitionState &state = Main::get()->state();
     m_impl->timer.start(g_pm->timer_reg, this);
-    m_impl->initial = algo::rect_center(state.get_robot_box());
+    m_impl->initial = state.get_robot_center();
     Q_EMIT started();
 }
 
@@ -130,7 +130,8 @@ void Procedure::movement_loop() {
     ) { return; }
 
     // Acquire the current robot position
-    vector2d center = algo::rect_center(Main::get()->state().get_robot_box(true));
+    state.consume_robot_box();
+    vector2d center = state.get_robot_center();
     vector2d target = m_impl->path[m_impl->index];
     // Source node is either the initial position or the last node
     vector2d source = m_impl->index > 0 ? m_impl->path[m_impl->index - 1] : m_impl->initial;
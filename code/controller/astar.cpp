@@ -5,10 +5,11 @@
 #include "../gui/griddisplay.h"
 #include "../utility/algorithm.h"
 
-#include <unordered_set>
-
+#include <algorithm>
+#include <limits>
 #include <set>
 #include <map>
+#include <vector>
 
 #ifndef NDEBUG
 #include <cassert>
@@ -16,137 +17,172 @@
 
 #define TERRAIN_WALL -1
 
-struct node {
-
-    node() :
-        x(0),
-        y(0),
-        g(0),
-        h(0),
-        f(0),
-        terrain(0),
-        parent(nullptr) {}
-
-    bool operator==(const node &o) {
-        return x == o.x && y == o.y;
-    }
-
-    bool operator!=(const node &o) {
-        return x != o.x || y != o.y;
-    }
-
-    int x;
-    int y;
+namespace {
+    // Added to the cost of a step that changes direction
+    const int TURN_PENALTY = 5;
+
+    /**
+     * Binary min-heap of cell ids ordered by f, then h, then id. Each
+     * cell is held at most once, so a cell whose cost improves is moved
+     * up in place and the heap never grows past the number of cells.
+     */
+    class open_heap {
+    public:
+        open_heap(
+            std::size_t cells,
+            const std::vector<int> &f,
+            const std::vector<int> &h
+        ) :
+            m_f(f),
+            m_h(h),
+            m_pos(cells, -1) {
+            m_heap.reserve(cells);
+        }
 
-    int g;
-    int h;
-    int f;
+        bool empty() const {
+            return m_heap.empty();
+        }
 
-    int terrain;
+        /**
+         * Add a cell, or restore the heap order after its f decreased.
+         */
+        void push(int cell) {
+            int i = m_pos[cell];
+            if (i < 0) {
+                i = static_cast<int>(m_heap.size());
+                m_heap.push_back(cell);
+                m_pos[cell] = i;
+            }
+            sift_up(i);
+        }
 
-    node *parent;
-};
+        int pop() {
+            int top = m_heap.front();
+            m_pos[top] = -1;
+            int last = m_heap.back();
+            m_heap.pop_back();
+            if (!m_heap.empty()) {
+                m_heap[0] = last;
+                m_pos[last] = 0;
+                sift_down(0);
+            }
+            return top;
+        }
 
-static int get_h(node *a, node *b) {
-    int dx = a->x - b->x;
-    int dy = a->y - b->y;
-    return abs(dx) + abs(dy);
-}
+    private:
+        bool before(int a, int b) const {
+            if (m_f[a] != m_f[b]) { return m_f[a] < m_f[b]; }
+            if (m_h[a] != m_h[b]) { return m_h[a] < m_h[b]; }
+            return a < b;
+        }
 
-static void backtrack(
-    node *start,
-    node *dest,
-    std::list<node *> &path
-) {
-    node *cur = dest;
-    while (cur != start) {
-        path.push_front(cur);
-        cur = cur->parent;
-    }
-}
+        void place(int i, int cell) {
+            m_heap[i] = cell;
+            m_pos[cell] = i;
+        }
 
-static void get_neighbors(
-    node *cur,
-    array2d<node *, int> &world,
-    std::list<node *> &neighbors
-) {
-    int cx = cur->x;
-    int cy = cur->y;
-    int xs[] = {cx - 1, cx, cx, cx + 1};
-    int ys[] = {cy, cy - 1, cy + 1, cy};
-    for (int i = 0; i < 4; ++i) {
-        cx = xs[i];
-        cy = ys[i];
-        if (cx < 0 ||
-            cy < 0 ||
-            cx >= world.x() ||
-            cy >= world.y()) {
-            continue;
+        void sift_up(int i) {
+            int cell = m_heap[i];
+            while (i > 0) {
+                int parent = (i - 1) / 2;
+                if (!before(cell, m_heap[parent])) { break; }
+                place(i, m_heap[parent]);
+                i = parent;
+            }
+            place(i, cell);
         }
-        if (world[cx][cy]->terrain != TERRAIN_WALL) {
-            neighbors.push_back(world[cx][cy]);
+
+        void sift_down(int i) {
+            int cell = m_heap[i];
+            int size = static_cast<int>(m_heap.size());
+            while (true) {
+                int child = 2 * i + 1;
+                if (child >= size) { break; }
+                if (child + 1 < size && before(m_heap[child + 1], m_heap[child])) { ++child; }
+                if (!before(m_heap[child], cell)) { break; }
+                place(i, m_heap[child]);
+                i = child;
+            }
+            place(i, cell);
         }
-    }
+
+        const std::vector<int> &m_f;
+        const std::vector<int> &m_h;
+        std::vector<int> m_heap;
+        // Index of each cell in the heap, -1 if not in it
+        std::vector<int> m_pos;
+    };
 }
 
+/**
+ * A* over a grid stored row by row with cell id x * my + y. All state is
+ * in flat arrays allocated up front, and nothing is allocated while
+ * searching. A step costs one plus the terrain of the cell entered, and
+ * a turn from the direction the current cell was entered from costs
+ * TURN_PENALTY more.
+ *
+ * @param terrain cost of entering each cell, TERRAIN_WALL if blocked
+ * @param mx      grid width
+ * @param my      grid height
+ * @param start   start cell id
+ * @param dest    destination cell id
+ * @param path    appended with the cells after start up to dest, or
+ *                nothing if dest cannot be reached
+ */
 static void astar_search_path(
-    node *start,
-    node *dest,
-    array2d<node *, int> &world,
-    std::list<node *> &path
+    const std::vector<int> &terrain,
+    int mx, int my,
+    int start, int dest,
+    std::vector<vector2i> &path
 ) {
-    std::unordered_set<node *> open_set;
-    std::unordered_set<node *> closed_set;
-    node *cur;
-
-    start->g = 0;
-    start->h = get_h(start, dest);
-    start->f = start->h;
-
-    open_set.insert(start);
+    const auto cells = static_cast<std::size_t>(mx * my);
+    const int dx = dest / my;
+    const int dy = dest % my;
+    std::vector<int> g(cells, std::numeric_limits<int>::max());
+    std::vector<int> h(cells, 0);
+    std::vector<int> f(cells, 0);
+    std::vector<int> parent(cells, -1);
+    std::vector<char> closed(cells, 0);
+    open_heap open_set(cells, f, h);
+
+    g[start] = 0;
+    h[start] = abs(start / my - dx) + abs(start % my - dy);
+    f[start] = h[start];
+    open_set.push(start);
     while (!open_set.empty()) {
-        cur = nullptr;
-        for (node *node : open_set) {
-            if (cur == nullptr ||
-                node->f < cur->f ||
-                (node->f == cur->f && node->h < cur->h)) {
-                cur = node;
+        int cur = open_set.pop();
+        closed[cur] = 1;
+        int cx = cur / my;
+        int cy = cur % my;
+        int xs[] = {cx - 1, cx, cx, cx + 1};
+        int ys[] = {cy, cy - 1, cy + 1, cy};
+        for (int i = 0; i < 4; ++i) {
+            if (xs[i] < 0 || ys[i] < 0 || xs[i] >= mx || ys[i] >= my) {
+                continue;
             }
-        }
-        if (cur == nullptr) {
-            break;
-        }
-        open_set.erase(cur);
-        closed_set.insert(cur);
-
-        std::list<node *> neighbors;
-        get_neighbors(cur, world, neighbors);
-
-        for (node *neigh : neighbors) {
-            if (closed_set.find(neigh) != closed_set.end()) {
+            int neigh = xs[i] * my + ys[i];
+            if (terrain[neigh] == TERRAIN_WALL || closed[neigh]) {
                 continue;
             }
-            int cur_g = cur->g + get_h(cur, neigh) + world[neigh->x][neigh->y]->terrain;
-
-            if (cur->parent) {
-                int dx = cur->x - cur->parent->x;
-                int dy = cur->y - cur->parent->y;
-                bool turned =
-                    dx != neigh->x - cur->x ||
-                    dy != neigh->y - cur->y;
-                cur_g += turned * 5;
+            int cur_g = g[cur] + 1 + terrain[neigh];
+            // Steps in the same direction have the same id difference
+            if (parent[cur] >= 0 && cur - parent[cur] != neigh - cur) {
+                cur_g += TURN_PENALTY;
             }
-
-            if (cur_g <= neigh->g || neigh->g == 0) {
-                neigh->g = cur_g;
-                neigh->h = get_h(neigh, dest);
-                neigh->f = neigh->h + neigh->g;
-                neigh->parent = cur;
+            if (cur_g <= g[neigh]) {
+                g[neigh] = cur_g;
+                h[neigh] = abs(xs[i] - dx) + abs(ys[i] - dy);
+                f[neigh] = h[neigh] + cur_g;
+                parent[neigh] = cur;
+                open_set.push(neigh);
             }
-            open_set.insert(neigh);
         }
-        if (cur->x == dest->x && cur->y == dest->y) {
-            backtrack(start, dest, path);
+        if (cur == dest) {
+            std::size_t first = path.size();
+            for (int cell = dest; cell != start; cell = parent[cell]) {
+                path.emplace_back(cell / my, cell % my);
+            }
+            std::reverse(path.begin() + first, path.end());
             return;
         }
     }
@@ -212,23 +248,16 @@ void nrg::search_path(
 ) {
     int mx = static_cast<int>(terrain.x());
     int my = static_cast<int>(terrain.y());
-    std::list<node *> node_path;
-    array2d<node, int> nodes(mx, my);
-    array2d<node *, int> world(mx, my);
-    for (unsigned int x = 0; x < terrain.x(); ++x) {
-        for (unsigned int y = 0; y < terrain.y(); ++y) {
-            nodes[x][y].x = x;
-            nodes[x][y].y = y;
-            nodes[x][y].terrain = terrain[x][y];
-            world[x][y] = &nodes[x][y];
-        }
-    }
-    node *node_start = world[start.x()][start.y()];
-    node *node_dest = world[dest.x()][dest.y()];
-    astar_search_path(node_start, node_dest, world, node_path);
-    for (node *node : node_path) {
-        path.emplace_back(node->x, node->y);
+    std::vector<int> cells(terrain.xy());
+    for (int x = 0; x < mx; ++x) {
+        memcpy(&cells[x * my], terrain[x].get(), my * sizeof(int));
     }
+    astar_search_path(
+        cells, mx, my,
+        start.x() * my + start.y(),
+        dest.x() * my + dest.y(),
+        path
+    );
 }
 
 void nrg::search_path_del(
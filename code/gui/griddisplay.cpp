@@ -1,6 +1,8 @@
 #include "../camera/cameradisplay.h"
 #include "../camera/imageviewer.h"
+#include "../compstate/compstate.h"
 #include "../utility/logger.h"
+#include "global.h"
 #include "griddisplay.h"
 #include "gridbutton.h"
 
@@ -9,6 +11,8 @@
 #include <QRubberBand>
 #include <QMouseEvent>
 
+#include <cmath>
+
 #ifndef NDEBUG
 #include <QDebug>
 #endif
@@ -187,6 +191,7 @@ void GridDisplay::show_grid() {
         show_view();
         init_start_end_pos();
         m_grid_displayed = true;
+        apply_walls();
     } else {
         show_view();
     }
@@ -358,6 +363,31 @@ void GridDisplay::update_grid_location(double x, double y) {
     move_grid();
 }
 
+void GridDisplay::apply_walls() {
+    std::shared_ptr<CompetitionState::wall_arr> walls = Main::get()->state().get_walls();
+    if (!walls || !m_grid_displayed) { return; }
+    for (int y = 0; y < m_row_count; y++) {
+        for (int x = 0; x < m_column_count; x++) {
+            int &weight = m_square_selected[x][y];
+            if (weight == START_WEIGHT || weight == END_WEIGHT) { continue; }
+            // Detected cells are GRID_SIZE pixels of the captured frame
+            vector2d p = m_image_viewer->display_to_frame(
+                m_view->x() + (x + 0.5) * GRID_SIZE,
+                m_view->y() + (y + 0.5) * GRID_SIZE);
+            int wx = static_cast<int>(std::floor(p.x() / GRID_SIZE));
+            int wy = static_cast<int>(std::floor(p.y() / GRID_SIZE));
+            bool wall = wx >= 0 && wy >= 0 && wx < walls->x() && wy < walls->y() && (*walls)[wx][wy];
+            if (wall) {
+                weight = DEFAULT_WEIGHT;
+                m_button[x][y]->setStyleSheet(QString::fromLocal8Bit(BUTTON_SELECTED_STYLE).arg(255));
+            } else if (weight == DEFAULT_WEIGHT) {
+                weight = NOT_SELECTED_WEIGHT;
+                m_button[x][y]->setStyleSheet(BUTTON_STYLE);
+            }
+        }
+    }
+}
+
 void GridDisplay::move_grid() {
     // Update location to match m_x and m_y
     m_view->move((1 + m_x) * (m_image_viewer->width() / 2 - m_scene->width() / 2), (1 - m_y) * (m_image_viewer->height() / 2 - m_scene->height() / 2));
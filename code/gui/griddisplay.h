@@ -54,6 +54,13 @@ public Q_SLOTS:
 
     void update_grid_location(double x, double y);
 
+    /**
+     * Mark the cells over detected walls as walls, and clear the cells
+     * of walls that are no longer detected, with the last wall grid in
+     * the CompetitionState. Start and end positions are kept.
+     */
+    void apply_walls();
+
 protected Q_SLOTS:
 
     void button_clicked(int x, int y);
@@ -2,6 +2,7 @@
 #include "../controller/controller.h"
 #include "../gui/global.h"
 #include "../simulator/globalsim.h"
+#include "../utility/vector.h"
 
 #include "embeddedcontroller.h"
 #include "python.h"
@@ -101,19 +102,19 @@ PyObject *Embedded::emb_object_rect(PyObject *, PyObject *) {
 }
 
 PyObject *Embedded::emb_robot_pos(PyObject *, PyObject *) {
-    cv::Rect2d robot_rect = Main::get()->state().get_robot_box(false);
+    vector2d robot_pos = Main::get()->state().get_robot_center();
     PyObject *pos_tuple = PyTuple_New(2);
-    PyTuple_SetItem(pos_tuple, 0, PyFloat_FromDouble(robot_rect.x + robot_rect.width / 2));
-    PyTuple_SetItem(pos_tuple, 1, PyFloat_FromDouble(robot_rect.y + robot_rect.height / 2));
+    PyTuple_SetItem(pos_tuple, 0, PyFloat_FromDouble(robot_pos.x()));
+    PyTuple_SetItem(pos_tuple, 1, PyFloat_FromDouble(robot_pos.y()));
     return pos_tuple;
 }
 
 
 PyObject *Embedded::emb_object_pos(PyObject *, PyObject *) {
-    cv::Rect2d object_rect = Main::get()->state().get_robot_box(false);
+    vector2d object_pos = Main::get()->state().get_object_center();
     PyObject *pos_tuple = PyTuple_New(2);
-    PyTuple_SetItem(pos_tuple, 0, PyFloat_FromDouble(object_rect.x + object_rect.width / 2));
-    PyTuple_SetItem(pos_tuple, 1, PyFloat_FromDouble(object_rect.y + object_rect.height / 2));
+    PyTuple_SetItem(pos_tuple, 0, PyFloat_FromDouble(object_pos.x()));
+    PyTuple_SetItem(pos_tuple, 1, PyFloat_FromDouble(object_pos.y()));
     return pos_tuple;
 }
 
@@ -1,11 +1,17 @@
 #include <QApplication>
 
+#include "camera/calibration.h"
+#include "camera/frameinfo.h"
 #include "compstate/compstate.h"
 #include "gui/global.h"
 #include "gui/mainwindow.h"
+#include "video/boxfilter.h"
+#include "video/flowvelocity.h"
 #include "video/modify.h"
 
 Q_DECLARE_METATYPE(cv::Rect2d);
+Q_DECLARE_METATYPE(cv::Point2d);
+Q_DECLARE_METATYPE(cv::Size);
 Q_DECLARE_METATYPE(cv::UMat);
 Q_DECLARE_METATYPE(std::shared_ptr<CompetitionState::wall_arr>);
 
@@ -14,9 +20,17 @@ int main(int argc, char *argv[]) {
     qRegisterMetaType<std::shared_ptr<CompetitionState::wall_arr>>();
     qRegisterMetaType<std::shared_ptr<VideoModifier>>();
     qRegisterMetaType<cv::Rect2d>();
+    qRegisterMetaType<cv::Point2d>();
+    qRegisterMetaType<cv::Size>();
+    qRegisterMetaType<FrameInfo>();
+    qRegisterMetaType<TargetMotion>();
+    qRegisterMetaType<TargetFlow>();
 
     QApplication app(argc, argv);
 
+    // Positions are in pixels until the camera is calibrated
+    CameraCalibration::install(CameraCalibration::load(CameraCalibration::DEFAULT_FILE));
+
     Main::get() = new MainWindow;
     Main::get()->show();
 
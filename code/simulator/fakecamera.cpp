@@ -5,23 +5,41 @@
 #include "../gui/global.h"
 #include "../utility/vector.h"
 
-FakeCamera::FakeCamera() {
+/**
+ * @return the simulator, or null if there is none or there is no
+ * MainWindow, such as when the pipeline runs headless
+ */
+static std::shared_ptr<GlobalSim> lock_global_sim() {
+    if (!Main::get()) { return nullptr; }
+    return Main::get()->global_sim().lock();
+}
+
+FakeCamera::FakeCamera(std::shared_ptr<GlobalSim> sim) :
+    m_sim(std::move(sim)) {
     open(FAKE_CAMERA);
 }
 
 FakeCamera::~FakeCamera() = default;
 
 cv::Rect2d FakeCamera::get_robot_rect() {
+    return get_robot_rect(lock_global_sim().get());
+}
+
+cv::Point2d FakeCamera::get_object_rect() {
+    return get_object_rect(lock_global_sim().get());
+}
+
+cv::Rect2d FakeCamera::get_robot_rect(GlobalSim *sim) {
     double width = GlobalSim::Robot::WIDTH;
     vector2d loc;
-    if (auto lp = Main::get()->global_sim().lock()) { loc = lp->robot(); }
+    if (sim) { loc = sim->robot(); }
     loc += {WIDTH / 2, HEIGHT / 2};
     return {loc.x() - width / 2, loc.y() - width / 2, width, width};
 }
 
-cv::Point2d FakeCamera::get_object_rect() {
+cv::Point2d FakeCamera::get_object_rect(GlobalSim *sim) {
     vector2d loc;
-    if (auto lp = Main::get()->global_sim().lock()) { loc = lp->object(); }
+    if (sim) { loc = sim->object(); }
     loc += {WIDTH / 2, HEIGHT / 2};
     return {loc.x(), loc.y()};
 }
@@ -69,13 +87,14 @@ void gaussian_noise(cv::UMat &image) {
 }
 
 cv::VideoCapture &FakeCamera::operator>>(cv::UMat &image) {
-    cv::Rect2d robot = get_robot_rect();
+    std::shared_ptr<GlobalSim> sim = m_sim ? m_sim : lock_global_sim();
+    cv::Rect2d robot = get_robot_rect(sim.get());
     cv::Rect2d robot_l0 = robot;
     robot_l0.x += 2;
     robot_l0.y += 2;
     robot_l0.width -= 4;
     robot_l0.height -= 4;
-    cv::Point2d object = get_object_rect();
+    cv::Point2d object = get_object_rect(sim.get());
     int width = GlobalSim::Robot::WIDTH;
     image.create(cv::Size(640, 480), CV_8UC3);
     // Draw background
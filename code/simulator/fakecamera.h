@@ -3,6 +3,10 @@
 
 #include <opencv2/videoio.hpp>
 #include <QObject>
+#include <memory>
+
+// Forward declarations
+class GlobalSim;
 
 /**
  * Mocked VideoCapture class for use with simulated robot and
@@ -18,12 +22,23 @@ public:
         HEIGHT = 480
     };
 
-    FakeCamera();
+    /**
+     * @param sim simulator to draw, or nullptr to draw the simulator
+     *            of the MainWindow, if there is one
+     */
+    explicit FakeCamera(std::shared_ptr<GlobalSim> sim = nullptr);
     ~FakeCamera() override;
 
     static cv::Rect2d get_robot_rect();
     static cv::Point2d get_object_rect();
 
+    /**
+     * @param sim the simulator, or nullptr for a robot at the center
+     * @return the robot box in frame coordinates
+     */
+    static cv::Rect2d get_robot_rect(GlobalSim *sim);
+    static cv::Point2d get_object_rect(GlobalSim *sim);
+
     bool open(const cv::String &filename) override;
     bool open(const cv::String &filename, int api_pref) override;
     bool open(int index) override;
@@ -42,6 +57,7 @@ public:
     double get(int prop_id) const override;
 
 private:
+    std::shared_ptr<GlobalSim> m_sim;
     bool m_open;
 };
 
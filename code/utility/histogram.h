@@ -0,0 +1,129 @@
+#ifndef MINOTAUR_CPP_HISTOGRAM_H
+#define MINOTAUR_CPP_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fixed-size log-linear histogram of latency samples, in microseconds.
+ *
+ * Each power of two is split into eight linear sub-buckets, so any
+ * reported percentile is within 12.5% of the true value. Recording is
+ * wait-free and may happen from any thread while another thread reads.
+ */
+class latency_histogram {
+public:
+    enum {
+        SUB_BITS = 3,
+        SUB_BUCKETS = 1 << SUB_BITS,
+        // Covers samples up to 2^32 us, a little over an hour
+        MAX_BITS = 32,
+        NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS
+    };
+
+    latency_histogram() :
+        m_count(0),
+        m_sum(0),
+        m_max(0) {
+        reset();
+    }
+
+    /**
+     * Add a sample to the histogram.
+     *
+     * @param us the sample value in microseconds
+     */
+    void record(std::uint64_t us) {
+        m_buckets[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(us, std::memory_order_relaxed);
+        std::uint64_t prev = m_max.load(std::memory_order_relaxed);
+        while (us > prev && !m_max.compare_exchange_weak(prev, us, std::memory_order_relaxed));
+    }
+
+    /**
+     * Estimate a percentile of the recorded samples.
+     *
+     * @param p percentile in [0, 100]
+     * @return the upper bound of the bucket holding the percentile, or 0 if empty
+     */
+    std::uint64_t percentile(double p) const {
+        std::uint64_t total = count();
+        if (total == 0) { return 0; }
+        if (p < 0) { p = 0; }
+        if (p > 100) { p = 100; }
+        auto rank = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(total) + 0.5);
+        if (rank < 1) { rank = 1; }
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+            seen += m_buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                std::uint64_t upper = bucket_upper(i);
+                std::uint64_t top = max();
+                return upper < top ? upper : top;
+            }
+        }
+        return max();
+    }
+
+    std::uint64_t count() const {
+        return m_count.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t max() const {
+        return m_max.load(std::memory_order_relaxed);
+    }
+
+    double mean() const {
+        std::uint64_t n = count();
+        return n ? static_cast<double>(m_sum.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    void reset() {
+        for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+            m_buckets[i].store(0, std::memory_order_relaxed);
+        }
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @param us sample value
+     * @return index of the bucket holding the value
+     */
+    static std::size_t bucket_of(std::uint64_t us) {
+        if (us < SUB_BUCKETS) { return static_cast<std::size_t>(us); }
+        int msb = 0;
+        for (std::uint64_t v = us; v > 1; v >>= 1) { ++msb; }
+        if (msb >= MAX_BITS) { return NUM_BUCKETS - 1; }
+        std::uint64_t sub = (us >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return static_cast<std::size_t>((msb - SUB_BITS + 1) * SUB_BUCKETS + sub);
+    }
+
+    /**
+     * @param i bucket index
+     * @return the largest value that falls into the bucket
+     */
+    static std::uint64_t bucket_upper(std::size_t i) {
+        if (i < SUB_BUCKETS) { return i; }
+        std::size_t msb = i / SUB_BUCKETS + SUB_BITS - 1;
+        std::uint64_t sub = i % SUB_BUCKETS;
+        std::uint64_t width = std::uint64_t(1) << (msb - SUB_BITS);
+        return (std::uint64_t(1) << msb) + (sub + 1) * width - 1;
+    }
+
+    // Disable copy constructor and assignment
+    latency_histogram(const latency_histogram &) = delete;
+
+    latency_histogram &operator=(const latency_histogram &) = delete;
+
+private:
+    std::atomic<std::uint64_t> m_buckets[NUM_BUCKETS];
+    std::atomic<std::uint64_t> m_count;
+    std::atomic<std::uint64_t> m_sum;
+    std::atomic<std::uint64_t> m_max;
+};
+
+#endif //MINOTAUR_CPP_HISTOGRAM_H
@@ -0,0 +1,180 @@
+#ifndef MINOTAUR_CPP_RING_BUFFER_H
+#define MINOTAUR_CPP_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * Bounded lock-free ring buffer with a single producer and a single
+ * consumer, used to hand off frames between pipeline threads.
+ *
+ * Each cell carries a sequence number (Vyukov bounded queue), which makes
+ * popping safe from more than one thread. The producer relies on this to
+ * evict the oldest element itself when the buffer is full and the overflow
+ * policy is DROP_OLDEST, so the consumer never has to cooperate.
+ *
+ * @tparam val_t element type, must be default constructible
+ */
+template<typename val_t>
+class ring_buffer {
+public:
+    enum overflow {
+        // Evict the oldest queued element to make room for the new one
+        DROP_OLDEST = 0,
+        // Discard the new element and keep the queued ones
+        DROP_NEWEST = 1
+    };
+
+    explicit ring_buffer(std::size_t capacity, overflow policy = DROP_OLDEST) :
+        m_capacity(capacity > 0 ? capacity : 1),
+        m_policy(policy),
+        m_cells(new cell[m_capacity]),
+        m_head(0),
+        m_tail(0),
+        m_pushed(0),
+        m_popped(0),
+        m_dropped(0) {
+        for (std::size_t i = 0; i < m_capacity; ++i) {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Push an element onto the buffer. Must only be called by the producer.
+     *
+     * @param val the element to push
+     * @return false if an element, either this one or the oldest, was dropped
+     */
+    bool push(const val_t &val) {
+        bool evicted = false;
+        std::size_t pos = m_head.load(std::memory_order_relaxed);
+        for (;;) {
+            cell &c = m_cells[pos % m_capacity];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                // Only one producer, the head cannot move underneath us
+                m_head.store(pos + 1, std::memory_order_relaxed);
+                c.data = val;
+                c.seq.store(pos + 1, std::memory_order_release);
+                m_pushed.fetch_add(1, std::memory_order_relaxed);
+                return !evicted;
+            }
+            // The buffer is full; if the oldest element has been evicted already
+            // and the cell is still busy, the consumer is mid-read of it
+            if (m_policy == DROP_NEWEST || evicted) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            val_t oldest;
+            if (pop_cell(oldest)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            evicted = true;
+        }
+    }
+
+    /**
+     * Pop the oldest element from the buffer. Must only be called by the consumer.
+     *
+     * @param val receives the popped element
+     * @return true if an element was popped
+     */
+    bool pop(val_t &val) {
+        if (!pop_cell(val)) { return false; }
+        m_popped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /**
+     * @return approximate number of queued elements
+     */
+    std::size_t size() const {
+        std::size_t head = m_head.load(std::memory_order_acquire);
+        std::size_t tail = m_tail.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    std::size_t capacity() const {
+        return m_capacity;
+    }
+
+    overflow policy() const {
+        return m_policy;
+    }
+
+    /**
+     * @return number of elements accepted by push()
+     */
+    std::size_t pushed() const {
+        return m_pushed.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return number of elements removed by pop()
+     */
+    std::size_t popped() const {
+        return m_popped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return number of elements lost to overflow
+     */
+    std::size_t dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    // Disable copy constructor and assignment
+    ring_buffer(const ring_buffer<val_t> &) = delete;
+
+    ring_buffer<val_t> &operator=(const ring_buffer<val_t> &) = delete;
+
+private:
+    struct cell {
+        std::atomic<std::size_t> seq;
+        val_t data;
+    };
+
+    bool pop_cell(val_t &val) {
+        std::size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell &c = m_cells[pos % m_capacity];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    val = std::move(c.data);
+                    // Release whatever the cell still references
+                    c.data = val_t();
+                    c.seq.store(pos + m_capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // Empty
+                return false;
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    const std::size_t m_capacity;
+    const overflow m_policy;
+    std::unique_ptr<cell[]> m_cells;
+
+    std::atomic<std::size_t> m_head;
+    std::atomic<std::size_t> m_tail;
+
+    std::atomic<std::size_t> m_pushed;
+    std::atomic<std::size_t> m_popped;
+    std::atomic<std::size_t> m_dropped;
+};
+
+#endif //MINOTAUR_CPP_RING_BUFFER_H
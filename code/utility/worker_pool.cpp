@@ -0,0 +1,94 @@
+#include <exception>
+
+#include "worker_pool.h"
+
+struct worker_pool::batch {
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t remaining;
+    std::exception_ptr error;
+};
+
+worker_pool::worker_pool(std::size_t workers) :
+    m_stopping(false) {
+    m_threads.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+        m_threads.emplace_back(&worker_pool::work, this);
+    }
+}
+
+worker_pool::~worker_pool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &thread : m_threads) { thread.join(); }
+}
+
+std::size_t worker_pool::workers() const {
+    return m_threads.size();
+}
+
+worker_pool &worker_pool::shared() {
+    static worker_pool pool(std::thread::hardware_concurrency() > 1
+        ? std::thread::hardware_concurrency() - 1 : 0);
+    return pool;
+}
+
+void worker_pool::run(const std::vector<task> &tasks) {
+    if (tasks.empty()) { return; }
+    batch current;
+    current.remaining = tasks.size();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // The caller takes the first task itself
+        for (std::size_t i = 1; i < tasks.size(); ++i) {
+            m_jobs.emplace_back(&tasks[i], &current);
+        }
+    }
+    m_wake.notify_all();
+    execute(job(&tasks[0], &current));
+    // Help with whatever is still queued instead of idling
+    for (;;) {
+        job next;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_jobs.empty()) { break; }
+            next = m_jobs.front();
+            m_jobs.pop_front();
+        }
+        execute(next);
+    }
+    std::unique_lock<std::mutex> lock(current.mutex);
+    current.done.wait(lock, [&current] { return current.remaining == 0; });
+    if (current.error) { std::rethrow_exception(current.error); }
+}
+
+void worker_pool::work() {
+    for (;;) {
+        job next;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty()) { return; }
+            next = m_jobs.front();
+            m_jobs.pop_front();
+        }
+        execute(next);
+    }
+}
+
+void worker_pool::execute(const job &next) {
+    std::exception_ptr error;
+    try {
+        (*next.first)();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    batch &owner = *next.second;
+    std::lock_guard<std::mutex> lock(owner.mutex);
+    if (error && !owner.error) { owner.error = error; }
+    // Notify under the lock, the batch lives on the caller's stack
+    if (--owner.remaining == 0) { owner.done.notify_all(); }
+}
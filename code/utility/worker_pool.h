@@ -0,0 +1,73 @@
+#ifndef MINOTAUR_CPP_WORKER_POOL_H
+#define MINOTAUR_CPP_WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Fixed set of persistent worker threads that run batches of tasks, used
+ * to spread per-frame work across cores without spawning threads per frame.
+ *
+ * A batch is submitted with run(), which blocks until every task in the
+ * batch has finished. The calling thread works on the batch as well, so a
+ * pool with no workers simply runs the tasks in order on the caller.
+ */
+class worker_pool {
+public:
+    typedef std::function<void()> task;
+
+    /**
+     * @param workers number of worker threads, not counting callers
+     */
+    explicit worker_pool(std::size_t workers);
+
+    ~worker_pool();
+
+    worker_pool(const worker_pool &) = delete;
+    worker_pool &operator=(const worker_pool &) = delete;
+
+    /**
+     * Run a batch of tasks concurrently and wait for all of them to finish.
+     * Safe to call from several threads at once. If any task throws, the
+     * first exception is rethrown once the whole batch has finished.
+     *
+     * @param tasks the tasks to run
+     */
+    void run(const std::vector<task> &tasks);
+
+    /**
+     * @return number of worker threads
+     */
+    std::size_t workers() const;
+
+    /**
+     * Pool shared by the image pipeline, with one worker
+     * less than the number of hardware threads.
+     */
+    static worker_pool &shared();
+
+private:
+    struct batch;
+    typedef std::pair<const task *, batch *> job;
+
+    void work();
+
+    /**
+     * Run a job and mark it done in its batch.
+     */
+    static void execute(const job &next);
+
+    std::vector<std::thread> m_threads;
+    std::deque<job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping;
+};
+
+#endif //MINOTAUR_CPP_WORKER_POOL_H
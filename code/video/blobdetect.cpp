@@ -0,0 +1,161 @@
+#include <opencv2/imgproc.hpp>
+
+#include "blobdetect.h"
+#include "../camera/actionbutton.h"
+#include "../compstate/compstate.h"
+#include "../compstate/parammanager.h"
+#include "../gui/global.h"
+
+namespace {
+    /**
+     * HSV range of a blob, with hue in [0, 180). The hue range wraps
+     * around when the minimum is greater than the maximum.
+     */
+    struct hsv_range {
+        int hue_min;
+        int hue_max;
+        int sat_min;
+        int val_min;
+    };
+
+    // Used when there are no runtime parameters, such as when headless
+    const hsv_range DEFAULT_ROBOT_RANGE = {35, 65, 100, 100};
+    const hsv_range DEFAULT_OBJECT_RANGE = {5, 30, 100, 100};
+    const double DEFAULT_CALIB_AREA = 400.0;
+    const double DEFAULT_ACQ_R_SIGMA = 1.34;
+}
+
+static void threshold_range(const cv::UMat &hsv, const hsv_range &range, cv::UMat &mask) {
+    if (range.hue_min <= range.hue_max) {
+        cv::inRange(hsv, cv::Scalar(range.hue_min, range.sat_min, range.val_min),
+                    cv::Scalar(range.hue_max, 255, 255), mask);
+    } else {
+        cv::UMat upper;
+        cv::inRange(hsv, cv::Scalar(range.hue_min, range.sat_min, range.val_min),
+                    cv::Scalar(180, 255, 255), upper);
+        cv::inRange(hsv, cv::Scalar(0, range.sat_min, range.val_min),
+                    cv::Scalar(range.hue_max, 255, 255), mask);
+        cv::bitwise_or(mask, upper, mask);
+    }
+}
+
+// Returns the bounding box of the component closest to the calibrated
+// area, or an empty box if none is close enough. The centroid of the
+// component is found from its moments, to subpixel precision.
+static cv::Rect2d find_blob(const cv::UMat &hsv, const hsv_range &range,
+                            double calib_area, double max_r, cv::Point2d &centroid) {
+    cv::UMat mask;
+    threshold_range(hsv, range, mask);
+    cv::Mat labels, stats, centroids;
+    int count = cv::connectedComponentsWithStats(mask, labels, stats, centroids, 8, CV_32S);
+    cv::Rect2d best;
+    double best_r = max_r;
+    // Label 0 is the background
+    for (int i = 1; i < count; ++i) {
+        const int *s = stats.ptr<int>(i);
+        cv::Rect2d box(s[cv::CC_STAT_LEFT], s[cv::CC_STAT_TOP], s[cv::CC_STAT_WIDTH], s[cv::CC_STAT_HEIGHT]);
+        double r = CompetitionState::acquisition_r(box, calib_area);
+        if (r < best_r) {
+            best_r = r;
+            best = box;
+            // Moments are about pixel centers, boxes are about pixel edges
+            const double *c = centroids.ptr<double>(i);
+            centroid = cv::Point2d(c[0] + 0.5, c[1] + 0.5);
+        }
+    }
+    return best;
+}
+
+BlobDetect::BlobDetect() :
+    m_robot_found(false),
+    m_object_found(false) {
+    if (!Main::get()) { return; }
+    CompetitionState *state = &Main::get()->state();
+    connect(this, &BlobDetect::robot_box, state, &CompetitionState::acquire_robot_box);
+    connect(this, &BlobDetect::object_box, state, &CompetitionState::acquire_object_box);
+    connect(this, &BlobDetect::robot_center, state, &CompetitionState::acquire_robot_center);
+    connect(this, &BlobDetect::object_center, state, &CompetitionState::acquire_object_center);
+    connect(this, &BlobDetect::robot_flow, state, &CompetitionState::acquire_robot_flow);
+    connect(this, &BlobDetect::object_flow, state, &CompetitionState::acquire_object_flow);
+    connect(this, &BlobDetect::robot_confirmed, state, &CompetitionState::confirm_robot_box);
+    connect(this, &BlobDetect::object_confirmed, state, &CompetitionState::confirm_object_box);
+}
+
+void BlobDetect::analyze(const FrameFeatures &frame, double scale) {
+    hsv_range robot = DEFAULT_ROBOT_RANGE;
+    hsv_range object = DEFAULT_OBJECT_RANGE;
+    double robot_area = DEFAULT_CALIB_AREA;
+    double object_area = DEFAULT_CALIB_AREA;
+    double max_r = DEFAULT_ACQ_R_SIGMA;
+    if (g_pm) {
+        robot = {g_pm->robot_hue_min, g_pm->robot_hue_max, g_pm->blob_sat_min, g_pm->blob_val_min};
+        object = {g_pm->object_hue_min, g_pm->object_hue_max, g_pm->blob_sat_min, g_pm->blob_val_min};
+        robot_area = g_pm->robot_calib_area;
+        object_area = g_pm->object_calib_area;
+        max_r = g_pm->area_acq_r_sigma;
+    }
+    // Calibrated areas are in full resolution pixels
+    double area_scale = scale * scale;
+    const cv::UMat &hsv = frame.hsv();
+    cv::Point2d robot_center;
+    cv::Point2d object_center;
+    m_robot = scale_rect(find_blob(hsv, robot, robot_area * area_scale, max_r, robot_center), 1.0 / scale);
+    m_object = scale_rect(find_blob(hsv, object, object_area * area_scale, max_r, object_center), 1.0 / scale);
+    m_robot_found = m_robot.area() > 0;
+    m_object_found = m_object.area() > 0;
+    pipeline_clock::time_point captured = frame.captured();
+    bool refine = g_pm && g_pm->centroid_refine;
+    // Flow is measured between consecutive frames the blob is found in
+    if (m_robot.area() > 0) {
+        Q_EMIT robot_box(m_robot);
+        if (refine) { Q_EMIT robot_center(robot_center * (1.0 / scale)); }
+        TargetFlow flow = m_robot_flow.update(frame.gray(), m_robot, scale, captured);
+        if (flow.valid) { Q_EMIT robot_flow(flow); }
+    } else {
+        m_robot_flow.reset();
+    }
+    if (m_object.area() > 0) {
+        Q_EMIT object_box(m_object);
+        if (refine) { Q_EMIT object_center(object_center * (1.0 / scale)); }
+        TargetFlow flow = m_object_flow.update(frame.gray(), m_object, scale, captured);
+        if (flow.valid) { Q_EMIT object_flow(flow); }
+    } else {
+        m_object_flow.reset();
+    }
+}
+
+void BlobDetect::draw(cv::UMat &img) {
+    if (m_robot.area() > 0) {
+        cv::rectangle(img, m_robot.tl(), m_robot.br(), cv::Scalar(255, 0, 0));
+    }
+    if (m_object.area() > 0) {
+        cv::rectangle(img, m_object.tl(), m_object.br(), cv::Scalar(0, 0, 255));
+    }
+}
+
+void BlobDetect::reuse() {
+    if (m_robot.area() > 0) { Q_EMIT robot_confirmed(); }
+    if (m_object.area() > 0) { Q_EMIT object_confirmed(); }
+}
+
+void BlobDetect::traverse() {
+    if (m_robot_found) {
+        Main::get()->state().begin_traversal();
+    }
+}
+
+void BlobDetect::move_object() {
+    if (m_robot_found && m_object_found) {
+        Main::get()->state().begin_object_move();
+    }
+}
+
+void BlobDetect::register_actions(ActionBox *box) {
+    ActionButton *traverse_button = box->add_action("Traverse");
+    ActionButton *object_move_button = box->add_action("Move Object");
+    ActionButton *stop_button = box->add_action("Stop Object");
+    connect(traverse_button, &QPushButton::clicked, this, &BlobDetect::traverse);
+    connect(object_move_button, &QPushButton::clicked, this, &BlobDetect::move_object);
+    connect(stop_button, &QPushButton::clicked, &Main::get()->state(), &CompetitionState::halt_object_move);
+    box->set_actions();
+}
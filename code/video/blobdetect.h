@@ -0,0 +1,88 @@
+#ifndef MINOTAUR_CPP_BLOBDETECT_H
+#define MINOTAUR_CPP_BLOBDETECT_H
+
+#include "flowvelocity.h"
+#include "modify.h"
+
+#include <atomic>
+
+/**
+ * Finds the robot and the object as colored blobs, an alternative to the
+ * trackers that needs no selected region and costs about a millisecond.
+ *
+ * The frame is thresholded by an HSV range for each of the two, and the
+ * connected components of each mask are scored against the calibrated
+ * areas in the same way CompetitionState validates boxes. The best
+ * component is published as the robot or object box. The HSV ranges and
+ * calibrated areas are runtime parameters.
+ */
+class BlobDetect : public VideoModifier {
+Q_OBJECT
+
+public:
+    BlobDetect();
+
+    void analyze(const FrameFeatures &frame, double scale) override;
+
+    void draw(cv::UMat &img) override;
+
+    void reuse() override;
+
+    void register_actions(ActionBox *box) override;
+
+    /**
+     * Emitted with the robot box in full resolution coordinates
+     * whenever the robot is found.
+     */
+    Q_SIGNAL void robot_box(const cv::Rect2d &box);
+
+    /**
+     * Emitted with the object box in full resolution coordinates
+     * whenever the object is found.
+     */
+    Q_SIGNAL void object_box(const cv::Rect2d &box);
+
+    /**
+     * Emitted after the box with the subpixel centroid of the blob in
+     * full resolution coordinates, when centroid refinement is on.
+     */
+    Q_SIGNAL void robot_center(const cv::Point2d &center);
+    Q_SIGNAL void object_center(const cv::Point2d &center);
+
+    /**
+     * Emitted with the optical flow of the robot or object between
+     * consecutive frames it was found in.
+     */
+    Q_SIGNAL void robot_flow(const TargetFlow &flow);
+    Q_SIGNAL void object_flow(const TargetFlow &flow);
+
+    /**
+     * Emitted for a frame unchanged from the last analyzed one,
+     * when the robot or object was found in that frame.
+     */
+    Q_SIGNAL void robot_confirmed();
+    Q_SIGNAL void object_confirmed();
+
+protected:
+    Q_SLOT void traverse();
+
+    Q_SLOT void move_object();
+
+private:
+    /**
+     * Last found boxes in full resolution coordinates, empty if
+     * the blob was not found in the last frame.
+     */
+    cv::Rect2d m_robot;
+    cv::Rect2d m_object;
+    /**
+     * Whether the boxes are found, for the action buttons on the GUI thread.
+     */
+    std::atomic<bool> m_robot_found;
+    std::atomic<bool> m_object_found;
+
+    FlowVelocity m_robot_flow;
+    FlowVelocity m_object_flow;
+};
+
+#endif //MINOTAUR_CPP_BLOBDETECT_H
@@ -0,0 +1,85 @@
+#include "boxfilter.h"
+
+namespace {
+    // State is [cx, cy, vx, vy, w, h], measurement is [cx, cy, w, h]
+    const int STATE_SIZE = 6;
+    const int MEASUREMENT_SIZE = 4;
+    // Initial uncertainty of a new track
+    const double INITIAL_POSITION_VAR = 100.0;
+    const double INITIAL_VELOCITY_VAR = 400.0 * 400.0;
+    // Process noise of the box size, per second
+    const double SIZE_NOISE_VAR = 25.0;
+}
+
+cv::Rect2d TargetMotion::predict(pipeline_clock::time_point t) const {
+    if (!valid) { return box; }
+    double dt = std::chrono::duration<double>(t - time).count();
+    return {box.x + velocity.x * dt, box.y + velocity.y * dt, box.width, box.height};
+}
+
+BoxFilter::BoxFilter(double accel_noise, double measurement_noise) :
+    m_kalman(STATE_SIZE, MEASUREMENT_SIZE, 0, CV_64F),
+    m_accel_noise(accel_noise) {
+    m_kalman.measurementMatrix = cv::Mat::zeros(MEASUREMENT_SIZE, STATE_SIZE, CV_64F);
+    m_kalman.measurementMatrix.at<double>(0, 0) = 1;
+    m_kalman.measurementMatrix.at<double>(1, 1) = 1;
+    m_kalman.measurementMatrix.at<double>(2, 4) = 1;
+    m_kalman.measurementMatrix.at<double>(3, 5) = 1;
+    cv::setIdentity(m_kalman.measurementNoiseCov, cv::Scalar::all(measurement_noise * measurement_noise));
+}
+
+void BoxFilter::reset() {
+    m_motion = TargetMotion();
+}
+
+void BoxFilter::set_time_step(double dt) {
+    cv::setIdentity(m_kalman.transitionMatrix);
+    m_kalman.transitionMatrix.at<double>(0, 2) = dt;
+    m_kalman.transitionMatrix.at<double>(1, 3) = dt;
+    // White noise acceleration for the center, random walk for the size
+    double q = m_accel_noise * m_accel_noise;
+    cv::Mat &Q = m_kalman.processNoiseCov;
+    Q = cv::Mat::zeros(STATE_SIZE, STATE_SIZE, CV_64F);
+    for (int i = 0; i < 2; ++i) {
+        Q.at<double>(i, i) = q * dt * dt * dt / 3;
+        Q.at<double>(i, i + 2) = q * dt * dt / 2;
+        Q.at<double>(i + 2, i) = q * dt * dt / 2;
+        Q.at<double>(i + 2, i + 2) = q * dt;
+    }
+    Q.at<double>(4, 4) = SIZE_NOISE_VAR * dt;
+    Q.at<double>(5, 5) = SIZE_NOISE_VAR * dt;
+}
+
+void BoxFilter::update(const cv::Rect2d &box, pipeline_clock::time_point time) {
+    cv::Mat measurement = (cv::Mat_<double>(MEASUREMENT_SIZE, 1) <<
+        box.x + box.width / 2, box.y + box.height / 2, box.width, box.height);
+    if (!m_motion.valid) {
+        // Start at the measured box, not moving
+        m_kalman.statePost = (cv::Mat_<double>(STATE_SIZE, 1) <<
+            measurement.at<double>(0), measurement.at<double>(1), 0, 0,
+            measurement.at<double>(2), measurement.at<double>(3));
+        cv::setIdentity(m_kalman.errorCovPost, cv::Scalar::all(INITIAL_POSITION_VAR));
+        m_kalman.errorCovPost.at<double>(2, 2) = INITIAL_VELOCITY_VAR;
+        m_kalman.errorCovPost.at<double>(3, 3) = INITIAL_VELOCITY_VAR;
+    } else {
+        double dt = std::chrono::duration<double>(time - m_motion.time).count();
+        set_time_step(dt > 0 ? dt : 0);
+        m_kalman.predict();
+        m_kalman.correct(measurement);
+    }
+    const cv::Mat &x = m_kalman.statePost;
+    const cv::Mat &P = m_kalman.errorCovPost;
+    double w = x.at<double>(4);
+    double h = x.at<double>(5);
+    m_motion.valid = true;
+    m_motion.time = time;
+    m_motion.box = {x.at<double>(0) - w / 2, x.at<double>(1) - h / 2, w, h};
+    m_motion.velocity = {x.at<double>(2), x.at<double>(3)};
+    m_motion.covariance = cv::Matx22d(
+        P.at<double>(0, 0), P.at<double>(0, 1),
+        P.at<double>(1, 0), P.at<double>(1, 1));
+}
+
+const TargetMotion &BoxFilter::motion() const {
+    return m_motion;
+}
@@ -0,0 +1,94 @@
+#ifndef MINOTAUR_CPP_BOXFILTER_H
+#define MINOTAUR_CPP_BOXFILTER_H
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include "../camera/frameinfo.h"
+
+/**
+ * Filtered motion of a tracked target at a point in time, in pixels
+ * and seconds.
+ */
+struct TargetMotion {
+    TargetMotion() :
+        valid(false) {}
+
+    /**
+     * Box extrapolated to the given time at constant velocity.
+     *
+     * @param t the time to predict the box at
+     * @return the predicted box, or the filtered box if the motion is invalid
+     */
+    cv::Rect2d predict(pipeline_clock::time_point t) const;
+
+    /**
+     * Whether a target has been measured since the filter was reset.
+     */
+    bool valid;
+    /**
+     * Time of the last measurement.
+     */
+    pipeline_clock::time_point time;
+    /**
+     * Filtered box at the time of the last measurement.
+     */
+    cv::Rect2d box;
+    /**
+     * Filtered velocity of the box center in pixels per second.
+     */
+    cv::Point2d velocity;
+    /**
+     * Covariance of the filtered center position.
+     */
+    cv::Matx22d covariance;
+};
+
+Q_DECLARE_METATYPE(TargetMotion);
+
+/**
+ * Constant velocity Kalman filter over a bounding box. The state is the
+ * box center, the center velocity, and the box size; each measurement is
+ * a box. Measurements may arrive at irregular times.
+ */
+class BoxFilter {
+public:
+    enum {
+        // Standard deviation of the target acceleration, in pixels per second squared
+        DEFAULT_ACCEL_NOISE = 400,
+        // Standard deviation of a measured box edge, in pixels
+        DEFAULT_MEASUREMENT_NOISE = 2
+    };
+
+    explicit BoxFilter(
+        double accel_noise = DEFAULT_ACCEL_NOISE,
+        double measurement_noise = DEFAULT_MEASUREMENT_NOISE
+    );
+
+    /**
+     * Forget the target, so the next measurement starts a new track.
+     */
+    void reset();
+
+    /**
+     * Predict the state to the time of the measurement and correct it.
+     *
+     * @param box  measured box
+     * @param time time at which the box was measured
+     */
+    void update(const cv::Rect2d &box, pipeline_clock::time_point time);
+
+    /**
+     * @return the current filtered motion
+     */
+    const TargetMotion &motion() const;
+
+private:
+    void set_time_step(double dt);
+
+    cv::KalmanFilter m_kalman;
+    double m_accel_noise;
+    TargetMotion m_motion;
+};
+
+#endif //MINOTAUR_CPP_BOXFILTER_H
@@ -0,0 +1,101 @@
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "calibrate.h"
+#include "../camera/actionbutton.h"
+#include "../camera/calibration.h"
+#include "../compstate/parammanager.h"
+#include "../utility/logger.h"
+
+namespace {
+    // Used when there are no runtime parameters, such as when headless
+    const int DEFAULT_BOARD_COLS = 9;
+    const int DEFAULT_BOARD_ROWS = 6;
+    const double DEFAULT_SQUARE_SIZE = 25.0;
+}
+
+Calibrate::Calibrate() = default;
+
+cv::Size Calibrate::board_size() {
+    if (!g_pm) { return {DEFAULT_BOARD_COLS, DEFAULT_BOARD_ROWS}; }
+    return {g_pm->calib_board_cols, g_pm->calib_board_rows};
+}
+
+void Calibrate::analyze(const FrameFeatures &frame, double scale) {
+    const cv::UMat &gray = frame.gray();
+    cv::Size board = board_size();
+    std::vector<cv::Point2f> corners;
+    bool found = cv::findChessboardCorners(
+        gray, board, corners,
+        cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE | cv::CALIB_CB_FAST_CHECK);
+    if (found) {
+        cv::cornerSubPix(gray, corners, cv::Size(5, 5), cv::Size(-1, -1),
+                         cv::TermCriteria(cv::TermCriteria::EPS | cv::TermCriteria::COUNT, 30, 0.01));
+        for (cv::Point2f &corner : corners) { corner *= static_cast<float>(1.0 / scale); }
+    } else {
+        corners.clear();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_corners = std::move(corners);
+    m_frame_size = cv::Size(cvRound(gray.cols / scale), cvRound(gray.rows / scale));
+    // Views of another board size cannot be calibrated together
+    if (board != m_board) {
+        m_views.clear();
+        m_board = board;
+    }
+}
+
+void Calibrate::draw(cv::UMat &img) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_corners.empty()) { return; }
+    cv::drawChessboardCorners(img, m_board, m_corners, true);
+}
+
+void Calibrate::capture_view() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_corners.empty()) {
+        log() << "No chessboard to capture";
+        return;
+    }
+    m_views.push_back(m_corners);
+    log() << "Captured chessboard view " << m_views.size();
+}
+
+void Calibrate::calibrate() {
+    std::vector<std::vector<cv::Point2f>> views;
+    cv::Size board;
+    cv::Size size;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        views = m_views;
+        board = m_board;
+        size = m_frame_size;
+    }
+    double square = g_pm ? g_pm->calib_square_size : DEFAULT_SQUARE_SIZE;
+    std::shared_ptr<CameraCalibration> calibration =
+        CameraCalibration::from_chessboard(views, size, board, square);
+    if (!calibration) {
+        log() << "Calibration failed with " << views.size() << " views";
+        return;
+    }
+    if (!calibration->save(CameraCalibration::DEFAULT_FILE)) {
+        log() << "Failed to save calibration to " << CameraCalibration::DEFAULT_FILE;
+    }
+    CameraCalibration::install(calibration);
+    log() << "Calibrated from " << views.size() << " views";
+}
+
+void Calibrate::clear_calibration() {
+    CameraCalibration::install(nullptr);
+    log() << "Calibration cleared";
+}
+
+void Calibrate::register_actions(ActionBox *box) {
+    ActionButton *capture_button = box->add_action("Capture View");
+    ActionButton *calibrate_button = box->add_action("Calibrate");
+    ActionButton *clear_button = box->add_action("Clear Calibration");
+    connect(capture_button, &QPushButton::clicked, this, &Calibrate::capture_view);
+    connect(calibrate_button, &QPushButton::clicked, this, &Calibrate::calibrate);
+    connect(clear_button, &QPushButton::clicked, this, &Calibrate::clear_calibration);
+    box->set_actions();
+}
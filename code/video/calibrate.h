@@ -0,0 +1,60 @@
+#ifndef MINOTAUR_CPP_CALIBRATE_H
+#define MINOTAUR_CPP_CALIBRATE_H
+
+#include "modify.h"
+
+#include <mutex>
+
+/**
+ * Calibrates the camera from views of a chessboard, so that positions
+ * are in field units and the displayed frame is undistorted.
+ *
+ * The chessboard is found in every frame and drawn. Views are captured
+ * by hand from several angles and distances; the board in the last view
+ * must lie flat on the field, since it defines the field axes. The
+ * calibration is then computed, saved to CameraCalibration::DEFAULT_FILE,
+ * and installed. The board size and square size are runtime parameters.
+ */
+class Calibrate : public VideoModifier {
+Q_OBJECT
+
+public:
+    Calibrate();
+
+    void analyze(const FrameFeatures &frame, double scale) override;
+
+    void draw(cv::UMat &img) override;
+
+    void register_actions(ActionBox *box) override;
+
+    /**
+     * Keep the chessboard corners found in the last frame as a view.
+     */
+    Q_SLOT void capture_view();
+
+    /**
+     * Compute, save, and install the calibration from the captured views.
+     */
+    Q_SLOT void calibrate();
+
+    /**
+     * Remove the installed calibration, so that positions are in pixels.
+     */
+    Q_SLOT void clear_calibration();
+
+private:
+    static cv::Size board_size();
+
+    // Guards the corners and views, which are used on the GUI thread
+    std::mutex m_mutex;
+    /**
+     * Corners found in the last frame in full resolution coordinates,
+     * empty if the chessboard was not found.
+     */
+    std::vector<cv::Point2f> m_corners;
+    std::vector<std::vector<cv::Point2f>> m_views;
+    cv::Size m_board;
+    cv::Size m_frame_size;
+};
+
+#endif //MINOTAUR_CPP_CALIBRATE_H
@@ -0,0 +1,38 @@
+#include <opencv2/imgproc.hpp>
+
+#include "centroid.h"
+
+namespace {
+    // Border deviations a pixel must differ by to be counted
+    const double NOISE_SIGMA = 2.0;
+    // Weights below this total are no target at all
+    const double MIN_MASS = 1.0;
+}
+
+bool contrast_centroid(const cv::UMat &img, const cv::Rect2d &box, cv::Point2d &center) {
+    cv::Rect roi = cv::Rect(box) & cv::Rect(cv::Point(0, 0), img.size());
+    if (roi.width < 3 || roi.height < 3) { return false; }
+    cv::Mat gray;
+    cv::Mat patch = img(roi).getMat(cv::ACCESS_READ);
+    if (patch.channels() == 3) {
+        cv::cvtColor(patch, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        gray = patch;
+    }
+    // The one pixel border is the background
+    cv::Mat border(gray.size(), CV_8U, cv::Scalar(255));
+    border(cv::Rect(1, 1, gray.cols - 2, gray.rows - 2)).setTo(0);
+    cv::Scalar mean;
+    cv::Scalar stddev;
+    cv::meanStdDev(gray, mean, stddev, border);
+    // Each step is a single vectorized pass over the box
+    cv::Mat weights;
+    cv::absdiff(gray, mean, weights);
+    cv::threshold(weights, weights, NOISE_SIGMA * stddev[0], 0, cv::THRESH_TOZERO);
+    cv::Moments m = cv::moments(weights);
+    if (m.m00 < MIN_MASS) { return false; }
+    // Moments are about pixel centers
+    center.x = roi.x + m.m10 / m.m00 + 0.5;
+    center.y = roi.y + m.m01 / m.m00 + 0.5;
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef MINOTAUR_CPP_CENTROID_H
+#define MINOTAUR_CPP_CENTROID_H
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * Find the subpixel centroid of a target inside its box, which is more
+ * precise than the center of a box aligned to whole pixels.
+ *
+ * Each pixel is weighted by how far its gray level is from the level of
+ * the box border, which is taken to be background, and the centroid is
+ * found from the first order moments of the weights. Differences within
+ * the noise of the border are not counted. The centroid is in the same
+ * coordinates as boxes, where pixel i spans [i, i + 1).
+ *
+ * @param img    frame, in BGR or grayscale
+ * @param box    box around the target, clipped to the frame
+ * @param center the centroid, set only if found
+ * @return whether the box contrasts with its border
+ */
+bool contrast_centroid(const cv::UMat &img, const cv::Rect2d &box, cv::Point2d &center);
+
+#endif //MINOTAUR_CPP_CENTROID_H
@@ -0,0 +1,81 @@
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include "flowvelocity.h"
+
+#include <algorithm>
+
+namespace {
+    // Largest distance in analysis pixels between a point and where it
+    // flows back to, for the point to be kept
+    const float MAX_ROUND_TRIP = 0.5f;
+    // Corner detection parameters
+    const double CORNER_QUALITY = 0.01;
+    const double CORNER_MIN_DISTANCE = 3.0;
+}
+
+static double median(std::vector<double> &values) {
+    auto mid = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+}
+
+FlowVelocity::FlowVelocity() :
+    m_scale(0) {}
+
+void FlowVelocity::reset() {
+    m_prev.release();
+    m_points.clear();
+}
+
+TargetFlow FlowVelocity::update(const cv::UMat &gray, const cv::Rect2d &box, double scale,
+                                pipeline_clock::time_point time) {
+    TargetFlow flow;
+    flow.time = time;
+    flow.position = cv::Point2d(box.x + box.width / 2, box.y + box.height / 2);
+    if (scale != m_scale || m_prev.size() != gray.size()) { reset(); }
+
+    if (!m_points.empty()) {
+        // Follow the points forward, then back to check them
+        std::vector<cv::Point2f> next;
+        std::vector<cv::Point2f> back;
+        std::vector<uchar> status;
+        std::vector<uchar> back_status;
+        std::vector<float> err;
+        cv::Size window(WINDOW_SIZE, WINDOW_SIZE);
+        cv::calcOpticalFlowPyrLK(m_prev, gray, m_points, next, status, err, window, MAX_LEVEL);
+        cv::calcOpticalFlowPyrLK(gray, m_prev, next, back, back_status, err, window, MAX_LEVEL);
+        std::vector<double> dx;
+        std::vector<double> dy;
+        for (std::size_t i = 0; i < m_points.size(); ++i) {
+            if (!status[i] || !back_status[i]) { continue; }
+            cv::Point2f round_trip = back[i] - m_points[i];
+            if (round_trip.dot(round_trip) > MAX_ROUND_TRIP * MAX_ROUND_TRIP) { continue; }
+            dx.push_back(next[i].x - m_points[i].x);
+            dy.push_back(next[i].y - m_points[i].y);
+        }
+        flow.interval = std::chrono::duration<double>(time - m_time).count();
+        if (dx.size() >= MIN_POINTS && flow.interval > 0) {
+            flow.valid = true;
+            flow.points = static_cast<int>(dx.size());
+            flow.displacement = cv::Point2d(median(dx), median(dy)) * (1.0 / scale);
+            flow.velocity = flow.displacement * (1.0 / flow.interval);
+        }
+    }
+
+    // Find the corners to follow into the next frame
+    cv::Rect2d analysis_box(box.x * scale, box.y * scale, box.width * scale, box.height * scale);
+    cv::Rect roi = cv::Rect(analysis_box) & cv::Rect(cv::Point(0, 0), gray.size());
+    m_points.clear();
+    if (roi.width > 2 && roi.height > 2) {
+        cv::goodFeaturesToTrack(gray(roi), m_points, MAX_POINTS, CORNER_QUALITY, CORNER_MIN_DISTANCE);
+        for (cv::Point2f &p : m_points) {
+            p.x += roi.x;
+            p.y += roi.y;
+        }
+    }
+    m_prev = gray;
+    m_scale = scale;
+    m_time = time;
+    return flow;
+}
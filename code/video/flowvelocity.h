@@ -0,0 +1,104 @@
+#ifndef MINOTAUR_CPP_FLOWVELOCITY_H
+#define MINOTAUR_CPP_FLOWVELOCITY_H
+
+#include <opencv2/core.hpp>
+#include <QMetaType>
+
+#include <vector>
+
+#include "../camera/frameinfo.h"
+
+/**
+ * Displacement and velocity of a target between two frames, measured
+ * by optical flow, in pixels and seconds.
+ */
+struct TargetFlow {
+    TargetFlow() :
+        valid(false),
+        interval(0),
+        points(0) {}
+
+    /**
+     * Whether enough points were followed between the frames.
+     */
+    bool valid;
+    /**
+     * Time of the later frame.
+     */
+    pipeline_clock::time_point time;
+    /**
+     * Seconds between the frames.
+     */
+    double interval;
+    /**
+     * Center of the target box in the later frame.
+     */
+    cv::Point2d position;
+    /**
+     * Median displacement of the followed points.
+     */
+    cv::Point2d displacement;
+    /**
+     * Displacement over the interval, in pixels per second.
+     */
+    cv::Point2d velocity;
+    /**
+     * Number of points that agreed on the displacement.
+     */
+    int points;
+};
+
+Q_DECLARE_METATYPE(TargetFlow);
+
+/**
+ * Measures the motion of a target between consecutive frames with
+ * pyramidal Lucas-Kanade optical flow on a few corners inside its box.
+ *
+ * Unlike differences of successive boxes, which carry the jitter of the
+ * tracker, the flow follows the texture of the target itself. Corners
+ * are found again in the box of every frame and followed into the next;
+ * points that do not flow back to where they started are discarded, and
+ * the median of the rest is the displacement.
+ */
+class FlowVelocity {
+public:
+    enum {
+        // Most corners followed per target
+        MAX_POINTS = 24,
+        // Fewest points that must agree for a measurement
+        MIN_POINTS = 3,
+        // Side of the flow search window in analysis pixels
+        WINDOW_SIZE = 15,
+        // Pyramid levels above the frame
+        MAX_LEVEL = 2
+    };
+
+    FlowVelocity();
+
+    /**
+     * Forget the last frame, so the next one starts over.
+     */
+    void reset();
+
+    /**
+     * Measure the flow from the last frame to this one and find the
+     * corners to follow into the next.
+     *
+     * @param gray  grayscale analysis frame, which must not be modified after
+     * @param box   target box in full resolution coordinates
+     * @param scale scale of the analysis frame relative to the full frame
+     * @param time  time at which the frame was captured
+     * @return the flow in full resolution coordinates, invalid for
+     *         the first frame or when too few points were followed
+     */
+    TargetFlow update(const cv::UMat &gray, const cv::Rect2d &box, double scale,
+                      pipeline_clock::time_point time);
+
+private:
+    cv::UMat m_prev;
+    std::vector<cv::Point2f> m_points;
+    double m_scale;
+    pipeline_clock::time_point m_time;
+};
+
+#endif //MINOTAUR_CPP_FLOWVELOCITY_H
@@ -0,0 +1,66 @@
+#include <opencv2/imgproc.hpp>
+
+#include "framefeatures.h"
+
+FrameFeatures::FrameFeatures(const cv::UMat &img, pipeline_clock::time_point captured) :
+    m_image(img),
+    m_captured(captured) {}
+
+const cv::UMat &FrameFeatures::image() const {
+    return m_image;
+}
+
+pipeline_clock::time_point FrameFeatures::captured() const {
+    return m_captured;
+}
+
+const cv::UMat &FrameFeatures::gray() const {
+    if (m_image.channels() == 1) { return m_image; }
+    std::call_once(m_gray_once, [this] {
+        cv::cvtColor(m_image, m_gray, cv::COLOR_BGR2GRAY);
+    });
+    return m_gray;
+}
+
+const cv::UMat &FrameFeatures::hsv() const {
+    std::call_once(m_hsv_once, [this] {
+        cv::cvtColor(m_image, m_hsv, cv::COLOR_BGR2HSV);
+    });
+    return m_hsv;
+}
+
+const cv::UMat &FrameFeatures::pyramid(int level) const {
+    if (level <= 0) { return m_image; }
+    std::lock_guard<std::mutex> lock(m_pyramid_mutex);
+    while (static_cast<int>(m_pyramid.size()) < level) {
+        const cv::UMat &prev = m_pyramid.empty() ? m_image : m_pyramid.back();
+        cv::UMat next;
+        cv::pyrDown(prev, next, cv::Size(prev.cols / 2, prev.rows / 2));
+        m_pyramid.push_back(next);
+    }
+    return m_pyramid[level - 1];
+}
+
+const cv::UMat &FrameFeatures::smoothed(int level) const {
+    const cv::UMat &base = pyramid(level);
+    const cv::UMat &down = pyramid(level + 1);
+    std::lock_guard<std::mutex> lock(m_smoothed_mutex);
+    cv::UMat &out = m_smoothed[level];
+    if (out.empty()) { cv::pyrUp(down, out, base.size()); }
+    return out;
+}
+
+const cv::UMat &FrameFeatures::blurred() const {
+    std::call_once(m_blurred_once, [this] {
+        cv::GaussianBlur(gray(), m_blurred, cv::Size(5, 5), 0);
+    });
+    return m_blurred;
+}
+
+const cv::UMat &FrameFeatures::edges(double low, double high, int aperture) const {
+    const cv::UMat &src = blurred();
+    std::lock_guard<std::mutex> lock(m_edges_mutex);
+    cv::UMat &out = m_edges[edge_key(low, high, aperture)];
+    if (out.empty()) { cv::Canny(src, out, low, high, aperture); }
+    return out;
+}
@@ -0,0 +1,104 @@
+#ifndef MINOTAUR_CPP_FRAMEFEATURES_H
+#define MINOTAUR_CPP_FRAMEFEATURES_H
+
+#include <opencv2/core/core.hpp>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "../camera/frameinfo.h"
+
+/**
+ * Features of a single analysis frame, shared by the modifiers that
+ * analyze it.
+ *
+ * Each feature is computed the first time any modifier asks for it, at
+ * most once per frame, and the same matrix is returned to every later
+ * caller. Callers may ask from several threads at once, as modifiers in
+ * a chain do; the returned matrices must not be modified.
+ */
+class FrameFeatures {
+public:
+    /**
+     * Implicit, so that a plain frame may be analyzed.
+     *
+     * @param img      analysis frame, in BGR or grayscale
+     * @param captured time at which the frame was captured
+     */
+    FrameFeatures(const cv::UMat &img, pipeline_clock::time_point captured = pipeline_clock::now());
+
+    FrameFeatures(const FrameFeatures &) = delete;
+    FrameFeatures &operator=(const FrameFeatures &) = delete;
+
+    /**
+     * @return the analysis frame itself
+     */
+    const cv::UMat &image() const;
+
+    /**
+     * @return the time at which the frame was captured
+     */
+    pipeline_clock::time_point captured() const;
+
+    /**
+     * @return the frame in grayscale, the frame itself if it already is
+     */
+    const cv::UMat &gray() const;
+
+    /**
+     * @return the frame in HSV, with hue in [0, 180)
+     */
+    const cv::UMat &hsv() const;
+
+    /**
+     * @param level pyramid level, where 0 is the frame and each
+     *              level is half the size of the one before
+     * @return the frame at the pyramid level
+     */
+    const cv::UMat &pyramid(int level) const;
+
+    /**
+     * @return the pyramid level blurred by scaling it down a
+     *         level and back up, which filters out noise
+     */
+    const cv::UMat &smoothed(int level) const;
+
+    /**
+     * @return the gray frame under a 5x5 Gaussian blur
+     */
+    const cv::UMat &blurred() const;
+
+    /**
+     * @return Canny edges of the blurred gray frame
+     */
+    const cv::UMat &edges(double low, double high, int aperture = 3) const;
+
+private:
+    typedef std::tuple<double, double, int> edge_key;
+
+    cv::UMat m_image;
+    pipeline_clock::time_point m_captured;
+
+    mutable std::once_flag m_gray_once;
+    mutable std::once_flag m_hsv_once;
+    mutable std::once_flag m_blurred_once;
+    mutable cv::UMat m_gray;
+    mutable cv::UMat m_hsv;
+    mutable cv::UMat m_blurred;
+
+    /**
+     * Levels and parameters are looked up under their mutex. The
+     * containers never move their elements, so returned references
+     * stay valid as other levels are added.
+     */
+    mutable std::mutex m_pyramid_mutex;
+    mutable std::deque<cv::UMat> m_pyramid;
+    mutable std::mutex m_smoothed_mutex;
+    mutable std::map<int, cv::UMat> m_smoothed;
+    mutable std::mutex m_edges_mutex;
+    mutable std::map<edge_key, cv::UMat> m_edges;
+};
+
+#endif //MINOTAUR_CPP_FRAMEFEATURES_H
@@ -0,0 +1,45 @@
+#include "modifierchain.h"
+#include "../utility/worker_pool.h"
+
+ModifierChain::ModifierChain(std::vector<std::shared_ptr<VideoModifier>> modifiers, worker_pool *pool) :
+    m_modifiers(std::move(modifiers)),
+    m_pool(pool ? pool : &worker_pool::shared()) {}
+
+void ModifierChain::analyze(const FrameFeatures &frame, double scale) {
+    std::vector<worker_pool::task> tasks;
+    tasks.reserve(m_modifiers.size());
+    for (const std::shared_ptr<VideoModifier> &modifier : m_modifiers) {
+        VideoModifier *target = modifier.get();
+        tasks.emplace_back([target, &frame, scale] { target->analyze(frame, scale); });
+    }
+    m_pool->run(tasks);
+}
+
+void ModifierChain::draw(cv::UMat &img) {
+    for (const std::shared_ptr<VideoModifier> &modifier : m_modifiers) {
+        modifier->draw(img);
+    }
+}
+
+void ModifierChain::reuse() {
+    for (const std::shared_ptr<VideoModifier> &modifier : m_modifiers) {
+        modifier->reuse();
+    }
+}
+
+bool ModifierChain::needs_analysis() const {
+    for (const std::shared_ptr<VideoModifier> &modifier : m_modifiers) {
+        if (modifier->needs_analysis()) { return true; }
+    }
+    return false;
+}
+
+void ModifierChain::register_actions(ActionBox *box) {
+    for (const std::shared_ptr<VideoModifier> &modifier : m_modifiers) {
+        modifier->register_actions(box);
+    }
+}
+
+const std::vector<std::shared_ptr<VideoModifier>> &ModifierChain::modifiers() const {
+    return m_modifiers;
+}
@@ -0,0 +1,48 @@
+#ifndef MINOTAUR_CPP_MODIFIERCHAIN_H
+#define MINOTAUR_CPP_MODIFIERCHAIN_H
+
+#include "modify.h"
+
+// Forward declarations
+class worker_pool;
+
+/**
+ * A VideoModifier that runs several modifiers on each frame.
+ *
+ * The modifiers analyze the same frame concurrently on the shared worker
+ * pool, since their analyses are independent of each other. Once every
+ * analysis has finished, the modifiers draw onto the frame one after
+ * another in the order they were given, so later modifiers draw on top.
+ *
+ * The modifiers share the features of the frame, so each conversion
+ * is done once for all of them.
+ */
+class ModifierChain : public VideoModifier {
+public:
+    /**
+     * @param modifiers the modifiers, in drawing order
+     * @param pool      pool to analyze on, or nullptr for the shared pool
+     */
+    explicit ModifierChain(
+        std::vector<std::shared_ptr<VideoModifier>> modifiers,
+        worker_pool *pool = nullptr
+    );
+
+    void analyze(const FrameFeatures &frame, double scale) override;
+
+    void draw(cv::UMat &img) override;
+
+    void reuse() override;
+
+    bool needs_analysis() const override;
+
+    void register_actions(ActionBox *box) override;
+
+    const std::vector<std::shared_ptr<VideoModifier>> &modifiers() const;
+
+private:
+    std::vector<std::shared_ptr<VideoModifier>> m_modifiers;
+    worker_pool *m_pool;
+};
+
+#endif //MINOTAUR_CPP_MODIFIERCHAIN_H
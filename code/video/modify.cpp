@@ -1,7 +1,13 @@
+#include <opencv2/imgproc.hpp>
+
 #include "modify.h"
 
+#include "blobdetect.h"
+#include "calibrate.h"
+#include "modifierchain.h"
 #include "squares.h"
 #include "shapedetect.h"
+#include "walldetect.h"
 
 #ifndef TRACKER_OFF
 #include "tracker.h"
@@ -17,18 +23,72 @@ std::shared_ptr<VideoModifier> VideoModifier::get_modifier(int modifier) {
         case OBJTRACK:
             return std::make_shared<TrackerModifier>();
 #endif
+        case BLOBDETECT:
+            return std::make_shared<BlobDetect>();
+        case WALLDETECT:
+            return std::make_shared<WallDetect>();
+        case CALIBRATE:
+            return std::make_shared<Calibrate>();
         default:
             return nullptr;
     }
 }
 
+std::shared_ptr<VideoModifier> VideoModifier::get_modifier(const std::vector<int> &modifiers) {
+    std::vector<std::shared_ptr<VideoModifier>> chain;
+    for (int modifier : modifiers) {
+        std::shared_ptr<VideoModifier> next = get_modifier(modifier);
+        if (next) { chain.push_back(next); }
+    }
+    if (chain.empty()) { return nullptr; }
+    if (chain.size() == 1) { return chain.front(); }
+    return std::make_shared<ModifierChain>(std::move(chain));
+}
+
 void VideoModifier::add_modifier_list(QComboBox *list) {
-    list->addItem("None");
-    list->addItem("Square");
-    list->addItem("Shape Detector");
+    list->addItem("None", NONE);
+    list->addItem("Square", SQUARES);
+    list->addItem("Shape Detector", SHAPEDETECT);
 #ifndef TRACKER_OFF
-    list->addItem("Object Tracker");
+    list->addItem("Object Tracker", OBJTRACK);
 #endif
+    list->addItem("Blob Detector", BLOBDETECT);
+    list->addItem("Wall Detector", WALLDETECT);
+    list->addItem("Camera Calibration", CALIBRATE);
+    list->addItem("Modifier Chain...", CHAIN);
+}
+
+void VideoModifier::process(cv::UMat &img, double scale, pipeline_clock::time_point captured) {
+    if (scale <= 0.0 || scale > 1.0) { scale = 1.0; }
+    cv::UMat analysis = img;
+    if (scale < 1.0) {
+        // Area interpolation avoids aliasing when scaling down
+        cv::resize(img, analysis, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+    analyze(FrameFeatures(analysis, captured), scale);
+    draw(img);
+}
+
+void VideoModifier::process_reused(cv::UMat &img) {
+    reuse();
+    draw(img);
+}
+
+void VideoModifier::reuse() {}
+
+bool VideoModifier::needs_analysis() const {
+    return false;
 }
 
 void VideoModifier::register_actions(ActionBox *) {}
+
+void VideoModifier::scale_points(std::vector<cv::Point> &points, double factor) {
+    for (cv::Point &point : points) {
+        point.x = cvRound(point.x * factor);
+        point.y = cvRound(point.y * factor);
+    }
+}
+
+cv::Rect2d VideoModifier::scale_rect(const cv::Rect2d &rect, double factor) {
+    return {rect.x * factor, rect.y * factor, rect.width * factor, rect.height * factor};
+}
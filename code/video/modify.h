@@ -2,30 +2,119 @@
 #define MINOTAUR_CPP_MODIFY_H
 
 #include <memory>
+#include <vector>
 
 #include <opencv2/core/core.hpp>
 
 #include <QObject>
 #include <QComboBox>
 
+#include "framefeatures.h"
 #include "../camera/actionbox.h"
 
+/**
+ * A VideoModifier analyzes frames in the image pipeline and draws its
+ * results onto them.
+ *
+ * Analysis may run on a scaled down copy of the frame, whose pixel count
+ * is what detectors and trackers cost scales with. Conversions of the
+ * analysis frame are shared through its FrameFeatures. Results are mapped
+ * back to full resolution coordinates before they are drawn onto, or
+ * published from, the full quality frame.
+ */
 class VideoModifier : public QObject {
 public:
     enum {
         NONE = 0,
         SQUARES = 1,
         SHAPEDETECT = 2,
-        OBJTRACK = 3
+        OBJTRACK = 3,
+        BLOBDETECT = 4,
+        WALLDETECT = 5,
+        CALIBRATE = 6,
+        // Several modifiers chosen by the user
+        CHAIN = 7
     };
 
     static std::shared_ptr<VideoModifier> get_modifier(int modifier);
 
+    /**
+     * Create a modifier that runs each of the given modifiers on every
+     * frame, analyzing concurrently and drawing in the given order.
+     *
+     * @param modifiers modifier enum values, in drawing order
+     * @return the chain, the modifier itself if only one is given,
+     *         or nullptr if none are
+     */
+    static std::shared_ptr<VideoModifier> get_modifier(const std::vector<int> &modifiers);
+
+    /**
+     * Add the available modifiers to a list. Each item
+     * holds its modifier enum value as its data.
+     *
+     * @param list the list to populate
+     */
     static void add_modifier_list(QComboBox *list);
 
-    virtual void modify(cv::UMat &img) = 0;
+    /**
+     * Analyze a frame and draw the results onto it.
+     *
+     * @param img      full resolution frame
+     * @param scale    analysis scale in (0, 1], relative to the frame
+     * @param captured time at which the frame was captured
+     */
+    void process(cv::UMat &img, double scale = 1.0, pipeline_clock::time_point captured = pipeline_clock::now());
+
+    /**
+     * Draw the results of the last analysis onto a frame that is
+     * unchanged from the analyzed one, without analyzing it.
+     *
+     * @param img full resolution frame
+     */
+    void process_reused(cv::UMat &img);
+
+    /**
+     * Analyze a frame. Results are kept in full resolution coordinates.
+     * The analysis frame may be the full frame itself, so nothing may be
+     * drawn onto it.
+     *
+     * @param frame analysis frame and its cached conversions
+     * @param scale scale of the analysis frame relative to the full frame
+     */
+    virtual void analyze(const FrameFeatures &frame, double scale) = 0;
+
+    /**
+     * Draw the results of the last analysis.
+     *
+     * @param img full resolution frame
+     */
+    virtual void draw(cv::UMat &img) = 0;
+
+    /**
+     * Called instead of analyze() for a frame unchanged from the last
+     * analyzed one, whose results still hold. Modifiers that publish
+     * results publish them again, marked as reused.
+     */
+    virtual void reuse();
+
+    /**
+     * @return whether the next frame must be analyzed even if it is
+     *         unchanged, such as while a target is being searched for
+     */
+    virtual bool needs_analysis() const;
 
     virtual void register_actions(ActionBox *box);
+
+    /**
+     * Scale points in place, such as mapping a contour
+     * from analysis to full resolution coordinates.
+     *
+     * @param points the points to scale
+     * @param factor scale factor
+     */
+    static void scale_points(std::vector<cv::Point> &points, double factor);
+
+    static cv::Rect2d scale_rect(const cv::Rect2d &rect, double factor);
 };
 
 Q_DECLARE_METATYPE(std::shared_ptr<VideoModifier>);
@@ -1,7 +1,9 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv/cv.hpp>
+#include <algorithm>
 
 #include "shapedetect.h"
+#include "../camera/actionbutton.h"
 #include "../utility/logger.h"
 
 const int minTriangleArea = 10;
@@ -40,42 +42,27 @@ void setLabel(cv::UMat &im, const std::string &label, std::vector<cv::Point> &co
     cv::putText(im, label, pt, font_face, scale, cv::Scalar(0, 0, 0), thickness, 8);
 }
 
-static cv::UMat findShapes(
-    const cv::UMat &src,
+// Finds shapes in the edges of the denoised grayscale image, along with all
+// contours and the labels of each shape to draw. Minimum areas are scaled by
+// area_scale, the square of the image scale relative to the full frame.
+// The edge image may be modified.
+static void findShapes(
+    cv::UMat &bw,
+    double area_scale,
+    std::vector<std::vector<cv::Point> > &contours,
+    std::vector<std::pair<std::string, std::vector<cv::Point> > > &labels,
     std::vector<std::vector<cv::Point> > &triangles,
     std::vector<std::vector<cv::Point> > &rectangles,
     std::vector<std::vector<cv::Point> > &circles
 ) {
+    contours.clear();
+    labels.clear();
     triangles.clear();
     rectangles.clear();
     circles.clear();
 
-    /*
-     * Process image to find contours.
-     */
-    // Convert to grayscale
-    cv::UMat gray;
-    cv::cvtColor(src, gray, CV_BGR2GRAY);
-
-    // Use Canny instead of threshold to catch squares with gradient shading
-    cv::UMat bw;
-
-    //Removes noise from photo
-    cv::fastNlMeansDenoising(gray, bw, 35, 10,
-                             21);    //(input, output, filter strength, template window size, search window size)
-
-    //Sharpen image
-    // cv::Mat blur;
-    // cv::GaussianBlur(gray, blur, cv::Size(0, 0), 3);	//(src, dst, , )
-    // cv::addWeighted(bw, 0.7, blur, 0.3, 0, bw);	//(src1, weight1, src2, weight2, gamma, output)
-
-    //Canny edge detection
-    cv::Canny(bw, bw, 0, 50, 5);
-
     // Find contours
-    std::vector<std::vector<cv::Point> > contours;
     cv::findContours(bw, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);    //(image, output, mode, method)
-    cv::drawContours(src, contours, -1, cv::Scalar(255, 0, 0), 2, CV_AA);
 
     //Close contours
     // std::vector<cv::Point> ConvexHullPoints;
@@ -85,7 +72,6 @@ static cv::UMat findShapes(
     // drawShapes(drawing, ConvexHullPoints, "Contours Convex Hull");
 
     std::vector<cv::Point> approx;
-    cv::UMat dst(src);
 
     /*
      * Shape detection using contours.
@@ -100,8 +86,8 @@ static cv::UMat findShapes(
         // 	continue;
 
         if (approx.size() == 3 &&
-            (std::fabs(cv::contourArea(contours[i])) > minTriangleArea && cv::isContourConvex(approx))) {
-            setLabel(dst, "TRI", contours[i]);    // Triangles
+            (std::fabs(cv::contourArea(contours[i])) > minTriangleArea * area_scale && cv::isContourConvex(approx))) {
+            labels.emplace_back("TRI", contours[i]);    // Triangles
             triangles.push_back(approx);
             //std::cout << "Triangle " << i << approx[0] << approx[1] << approx[2] << std::endl;
         } else if (approx.size() >= 4 && approx.size() <= 6) {
@@ -124,8 +110,8 @@ static cv::UMat findShapes(
             // Use the degrees obtained above and the number of vertices
             // to determine the shape of the contour
             if (vtc == 4 && min_cos >= -0.1 && max_cos <= 0.3 &&
-                (std::fabs(cv::contourArea(contours[i])) > min_square_area && cv::isContourConvex(approx))) {
-                setLabel(dst, "RECT", contours[i]);
+                (std::fabs(cv::contourArea(contours[i])) > min_square_area * area_scale && cv::isContourConvex(approx))) {
+                labels.emplace_back("RECT", contours[i]);
                 rectangles.push_back(approx);
 
                 //std::cout << "Rectangle " << i << approx[0] << approx[1] << approx[2] << approx[3] << std::endl;
@@ -135,7 +121,7 @@ static cv::UMat findShapes(
             // 	setLabel(dst, "PENTA", contours[i]);
             // else if (vtc == 6 && mincos >= -0.55 && maxcos <= -0.45)
             // 	setLabel(dst, "HEXA", contours[i]);
-        } else if (approx.size() > 6 && (std::fabs(cv::contourArea(contours[i])) > minCircleArea)) {
+        } else if (approx.size() > 6 && (std::fabs(cv::contourArea(contours[i])) > minCircleArea * area_scale)) {
             // Detect and label circles
             double area = cv::contourArea(contours[i]);
             // creates a rectangle around contours
@@ -147,24 +133,134 @@ static cv::UMat findShapes(
 
             if (std::abs(1 - ((double) r.width / r.height)) <= 0.2 &&
                 std::abs(1 - (area / (CV_PI * std::pow(radius, 2)))) <= 0.2) {
-                setLabel(dst, "CIR", contours[i]);
+                labels.emplace_back("CIR", contours[i]);
                 circles.push_back(approx);
                 //circle(dst, approx.back(), radius, cvScalar(0,255,0), 3, cv::LINE_AA);
             }
 
         }
     }
-    return dst;
 }
 
-void ShapeDetect::modify(cv::UMat &img) {
+ShapeDetect::ShapeDetect(int denoiser, int temporal_frames) :
+    m_denoiser(denoiser),
+    m_last_denoiser(denoiser),
+    m_history(static_cast<std::size_t>(std::max(temporal_frames, 1))),
+    m_history_next(0),
+    m_history_count(0) {}
+
+void ShapeDetect::set_denoiser(int denoiser) {
+    if (denoiser >= 0 && denoiser < NUM_DENOISERS) { m_denoiser = denoiser; }
+}
+
+int ShapeDetect::get_denoiser() const {
+    return m_denoiser;
+}
+
+const char *ShapeDetect::denoiser_name(int denoiser) {
+    switch (denoiser) {
+        case NL_MEANS:
+            return "NL Means";
+        case BILATERAL:
+            return "Bilateral";
+        case GAUSSIAN:
+            return "Gaussian";
+        case TEMPORAL:
+            return "Temporal";
+        default:
+            return "None";
+    }
+}
+
+void ShapeDetect::denoise(const cv::UMat &gray, cv::UMat &out, int denoiser) {
+    switch (denoiser) {
+        case NL_MEANS:
+            //(input, output, filter strength, template window size, search window size)
+            cv::fastNlMeansDenoising(gray, out, 35, 10, 21);
+            break;
+        case BILATERAL:
+            //(input, output, diameter, color sigma, space sigma)
+            cv::bilateralFilter(gray, out, 5, 50, 5);
+            break;
+        case TEMPORAL:
+            temporal_average(gray, out);
+            break;
+        default:
+            // Gaussian kernels are separable and run as two 1D passes
+            cv::GaussianBlur(gray, out, cv::Size(5, 5), 0);
+            break;
+    }
+}
+
+void ShapeDetect::temporal_average(const cv::UMat &gray, cv::UMat &out) {
+    if (m_history_sum.size() != gray.size()) {
+        m_history_count = 0;
+        m_history_next = 0;
+    }
+    if (m_history_count == 0) {
+        m_history_sum.create(gray.size(), CV_32F);
+        m_history_sum.setTo(cv::Scalar::all(0));
+    }
+    cv::UMat &slot = m_history[m_history_next];
+    // Replace the oldest frame in the sum once the history is full
+    if (m_history_count == m_history.size()) {
+        cv::subtract(m_history_sum, slot, m_history_sum);
+    } else {
+        ++m_history_count;
+    }
+    gray.convertTo(slot, CV_32F);
+    cv::add(m_history_sum, slot, m_history_sum);
+    m_history_next = (m_history_next + 1) % m_history.size();
+    m_history_sum.convertTo(out, CV_8U, 1.0 / m_history_count);
+}
+
+void ShapeDetect::analyze(const FrameFeatures &frame, double scale) {
     std::vector<std::vector<cv::Point>> triangles;
     std::vector<std::vector<cv::Point>> rectangles;
     std::vector<std::vector<cv::Point>> circles;
 
-    img = findShapes(img, triangles, rectangles, circles);
+    int denoiser = m_denoiser;
+    if (denoiser != m_last_denoiser) {
+        m_history_count = 0;
+        m_last_denoiser = denoiser;
+    }
+    // Use Canny instead of threshold to catch squares with gradient shading.
+    // The Gaussian denoiser is the blur the shared edge map is found on.
+    cv::UMat bw;
+    if (denoiser == GAUSSIAN) {
+        // Older versions of findContours modify their input
+        bw = frame.edges(0, 50, 5).clone();
+    } else {
+        cv::UMat denoised;
+        denoise(frame.gray(), denoised, denoiser);
+        cv::Canny(denoised, bw, 0, 50, 5);
+    }
+
+    findShapes(bw, scale * scale, m_contours, m_labels, triangles, rectangles, circles);
+    // Map results back to full resolution
+    for (auto &contour : m_contours) { scale_points(contour, 1.0 / scale); }
+    for (auto &label : m_labels) { scale_points(label.second, 1.0 / scale); }
+}
+
+void ShapeDetect::draw(cv::UMat &img) {
+    cv::drawContours(img, m_contours, -1, cv::Scalar(255, 0, 0), 2, CV_AA);
+    for (auto &label : m_labels) { setLabel(img, label.first, label.second); }
     // Outline rectangles and triangles in blue
     //drawShapes(*img, triangles);
     //drawShapes(*img, rectangles);
+}
+
+void ShapeDetect::register_actions(ActionBox *box) {
+    ActionButton *denoiser_button = box->add_action(
+        QString("Denoiser: ") + denoiser_name(m_denoiser));
+    // Cycle through the denoisers
+    connect(denoiser_button, &QPushButton::clicked, this, [this, denoiser_button] {
+        set_denoiser((m_denoiser + 1) % NUM_DENOISERS);
+        denoiser_button->setText(QString("Denoiser: ") + denoiser_name(m_denoiser));
+    });
+    box->set_actions();
+}
 
+const ShapeDetect::label_list &ShapeDetect::labels() const {
+    return m_labels;
 }
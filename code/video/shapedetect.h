@@ -10,9 +10,94 @@
 
 #include "modify.h"
 
+#include <atomic>
+#include <string>
+#include <utility>
+
 class ShapeDetect : public VideoModifier {
 public:
-    void modify(cv::UMat &img) override;
+    /**
+     * Filters run on the frame before finding edges.
+     */
+    enum Denoiser {
+        // Non-local means, by far the slowest
+        NL_MEANS = 0,
+        // Edge preserving bilateral filter
+        BILATERAL = 1,
+        // Separable Gaussian blur
+        GAUSSIAN = 2,
+        // Running average of the last few frames
+        TEMPORAL = 3,
+        NUM_DENOISERS
+    };
+
+    enum {
+        DEFAULT_TEMPORAL_FRAMES = 4
+    };
+
+    typedef std::vector<std::pair<std::string, std::vector<cv::Point>>> label_list;
+
+    /**
+     * @param denoiser        one of Denoiser
+     * @param temporal_frames number of frames averaged by the temporal filter
+     */
+    explicit ShapeDetect(int denoiser = GAUSSIAN, int temporal_frames = DEFAULT_TEMPORAL_FRAMES);
+
+    /**
+     * Change the denoiser. Safe to call from any thread.
+     *
+     * @param denoiser one of Denoiser
+     */
+    void set_denoiser(int denoiser);
+
+    int get_denoiser() const;
+
+    static const char *denoiser_name(int denoiser);
+
+    void analyze(const FrameFeatures &frame, double scale) override;
+
+    void draw(cv::UMat &img) override;
+
+    void register_actions(ActionBox *box) override;
+
+    /**
+     * @return the shapes found by the last analysis and their
+     *         labels, in full resolution coordinates
+     */
+    const label_list &labels() const;
+
+private:
+    /**
+     * Run the selected denoiser on a grayscale frame.
+     */
+    void denoise(const cv::UMat &gray, cv::UMat &out, int denoiser);
+
+    /**
+     * Add a frame to the temporal history and write the average of
+     * the history to out. The history restarts when the size changes.
+     */
+    void temporal_average(const cv::UMat &gray, cv::UMat &out);
+
+    std::atomic<int> m_denoiser;
+    /**
+     * Denoiser used by the previous analysis, to restart the
+     * temporal history when the denoiser changes.
+     */
+    int m_last_denoiser;
+
+    /**
+     * Last frames as floats, reused as a ring, and their running sum.
+     */
+    std::vector<cv::UMat> m_history;
+    cv::UMat m_history_sum;
+    std::size_t m_history_next;
+    std::size_t m_history_count;
+
+    /**
+     * Results of the last analysis, in full resolution coordinates.
+     */
+    std::vector<std::vector<cv::Point>> m_contours;
+    label_list m_labels;
 };
 
 
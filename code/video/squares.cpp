@@ -1,6 +1,10 @@
 #include "squares.h"
 
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+
+#include "../camera/actionbutton.h"
+#include "../utility/worker_pool.h"
 
 int thresh = 0;
 int N = 50;
@@ -16,80 +20,183 @@ static double angle(Point pt1, Point pt2, Point pt0) {
     return (dx1 * dx2 + dy1 * dy2) / sqrt((dx1 * dx1 + dy1 * dy1) * (dx2 * dx2 + dy2 * dy2) + 1e-10);
 }
 
-// returns sequence of squares detected on the image.
-// the sequence is stored in the specified memory storage
-static void findSquares(cv::UMat &image, vector<vector<Point> > &squares) {
-    squares.clear();
-
-    Mat pyr, timg, gray0(image.size(), CV_8U), gray;
+namespace {
+    // Threshold levels searched by a single task
+    const int LEVELS_PER_TASK = 10;
+    // Step between the levels tried on the pyramid level in coarse-to-fine mode
+    const int COARSE_LEVEL_STEP = 10;
+    // Margin added around a coarse square before refining it, relative to its size
+    const double REFINE_MARGIN = 0.25;
+}
 
-    // down-scale and upscale the image to filter out the noise
+// blurs the image by scaling it down and back up to filter out
+// the noise, and splits the result into its color planes
+static void filterPlanes(const cv::UMat &image, vector<Mat> &planes) {
+    Mat pyr, timg;
     pyrDown(image, pyr, Size(image.cols / 2, image.rows / 2));
     pyrUp(pyr, timg, image.size());
+    split(timg, planes);
+}
+
+// finds squares in a single color plane at the threshold levels
+// first, first + step, ... up to but excluding last
+static void findSquaresInLevels(
+    const Mat &gray0, int first, int last, int step,
+    double min_area, vector<vector<Point>> &squares) {
+    // buffers are local so that planes and levels can be searched concurrently
+    Mat gray;
     vector<vector<Point>> contours;
+    vector<Point> approx;
+
+    for (int l = first; l < last; l += step) {
+        // hack: use Canny instead of zero threshold level.
+        // Canny helps to catch squares with gradient shading
+        if (l == 0) {
+            // apply Canny. Take the upper threshold from slider
+            // and set the lower to 0 (which forces edges merging)
+            Canny(gray0, gray, 0, thresh, 5);
+            // dilate canny output to remove potential
+            // holes between edge segments
+            dilate(gray, gray, Mat(), Point(-1, -1));
+        } else {
+            // apply threshold if l!=0:
+            //     tgray(x,y) = gray(x,y) < (l+1)*255/N ? 255 : 0
+            gray = gray0 >= (l + 1) * 255 / N;
+        }
+
+        // find contours and store them all as a list
+        findContours(gray, contours, RETR_LIST, CHAIN_APPROX_SIMPLE);
+
+        // test each contour
+        for (const auto &contour : contours) {
+            // approximate contour with accuracy proportional
+            // to the contour perimeter
+            approxPolyDP(contour, approx, arcLength(contour, true) * 0.02, true);
+
+            // square contours should have 4 vertices after approximation
+            // relatively large area (to filter out noisy contours)
+            // and be convex.
+            // Note: absolute value of an area is used because
+            // area may be positive or negative - in accordance with the
+            // contour orientation
+            if (approx.size() == 4 &&
+                fabs(contourArea(approx)) > min_area &&
+                isContourConvex(approx)) {
+                double maxCosine = 0;
+
+                for (int j = 2; j < 5; j++) {
+                    // find the maximum cosine of the angle between joint edges
+                    double cosine = fabs(angle(approx[j % 4], approx[j - 2], approx[j - 1]));
+                    maxCosine = MAX(maxCosine, cosine);
+                }
 
-    // find squares in every color plane of the image
-    for (int c = 0; c < 3; c++) {
-        int ch[] = {c, 0};
-        mixChannels(&timg, 1, &gray0, 1, ch, 1);
-
-        // try several threshold levels
-        for (int l = 0; l < N; l++) {
-            // hack: use Canny instead of zero threshold level.
-            // Canny helps to catch squares with gradient shading
-            if (l == 0) {
-                // apply Canny. Take the upper threshold from slider
-                // and set the lower to 0 (which forces edges merging)
-                Canny(gray0, gray, 0, thresh, 5);
-                // dilate canny output to remove potential
-                // holes between edge segments
-                dilate(gray, gray, Mat(), Point(-1, -1));
-            } else {
-                // apply threshold if l!=0:
-                //     tgray(x,y) = gray(x,y) < (l+1)*255/N ? 255 : 0
-                gray = gray0 >= (l + 1) * 255 / N;
+                // if cosines of all angles are small
+                // (all angles are ~90 degree) then write quandrange
+                // vertices to resultant sequence
+                if (maxCosine < 0.3) {
+                    squares.push_back(approx);
+                }
             }
+        }
+    }
+}
+
+// searches every color plane at every step-th threshold level, spreading
+// planes and groups of levels across the worker pool; the results are
+// concatenated in plane and level order, as if searched one by one
+static void findSquaresInPlanes(
+    const vector<Mat> &planes, int step,
+    double min_area, vector<vector<Point>> &squares) {
+    int levels_per_task = LEVELS_PER_TASK * step;
+    int tasks_per_plane = (N + levels_per_task - 1) / levels_per_task;
+    vector<vector<vector<Point>>> found(planes.size() * tasks_per_plane);
+    vector<worker_pool::task> tasks;
+    tasks.reserve(found.size());
+    for (std::size_t c = 0; c < planes.size(); ++c) {
+        for (int t = 0; t < tasks_per_plane; ++t) {
+            const Mat &plane = planes[c];
+            int first = t * levels_per_task;
+            int last = std::min(first + levels_per_task, N);
+            vector<vector<Point>> &out = found[c * tasks_per_plane + t];
+            tasks.emplace_back([&plane, first, last, step, min_area, &out] {
+                findSquaresInLevels(plane, first, last, step, min_area, out);
+            });
+        }
+    }
+    worker_pool::shared().run(tasks);
+    for (auto &part : found) {
+        squares.insert(squares.end(), part.begin(), part.end());
+    }
+}
+
+// returns sequence of squares detected on the image.
+// the sequence is stored in the specified memory storage
+// min_area is the smallest square area in image pixels
+static void findSquares(const cv::UMat &image, vector<vector<Point> > &squares, double min_area) {
+    squares.clear();
+    vector<Mat> planes;
+    filterPlanes(image, planes);
+    findSquaresInPlanes(planes, 1, min_area, squares);
+}
+
+// finds squares in the whole frame, using its shared smoothed frame
+static void findSquares(const FrameFeatures &frame, vector<vector<Point> > &squares, double min_area) {
+    squares.clear();
+    vector<Mat> planes;
+    split(frame.smoothed(0), planes);
+    findSquaresInPlanes(planes, 1, min_area, squares);
+}
 
-            // find contours and store them all as a list
-            findContours(gray, contours, RETR_LIST, CHAIN_APPROX_SIMPLE);
-
-            vector<Point> approx;
-
-            // test each contour
-            for (const auto &contour : contours) {
-                // approximate contour with accuracy proportional
-                // to the contour perimeter
-                approxPolyDP(Mat(contour), approx, arcLength(Mat(contour), true) * 0.02, true);
-
-                // square contours should have 4 vertices after approximation
-                // relatively large area (to filter out noisy contours)
-                // and be convex.
-                // Note: absolute value of an area is used because
-                // area may be positive or negative - in accordance with the
-                // contour orientation
-                if (approx.size() == 4 &&
-                    fabs(contourArea(Mat(approx))) > 1000 &&
-                    isContourConvex(Mat(approx))) {
-                    double maxCosine = 0;
-
-                    for (int j = 2; j < 5; j++) {
-                        // find the maximum cosine of the angle between joint edges
-                        double cosine = fabs(angle(approx[j % 4], approx[j - 2], approx[j - 1]));
-                        maxCosine = MAX(maxCosine, cosine);
-                    }
-
-                    // if cosines of all angles are small
-                    // (all angles are ~90 degree) then write quandrange
-                    // vertices to resultant sequence
-                    if (maxCosine < 0.3) {
-                        squares.push_back(approx);
-                    }
+// merges overlapping rectangles until none overlap
+static void mergeOverlapping(vector<Rect> &rects) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (std::size_t i = 0; i < rects.size() && !merged; ++i) {
+            for (std::size_t j = i + 1; j < rects.size(); ++j) {
+                if ((rects[i] & rects[j]).area() > 0) {
+                    rects[i] |= rects[j];
+                    rects.erase(rects.begin() + j);
+                    merged = true;
+                    break;
                 }
             }
         }
     }
 }
 
+// finds squares by first searching a few threshold levels on the
+// half resolution pyramid level, then searching every level only
+// in the regions around the squares found there
+static void findSquaresCoarseToFine(const FrameFeatures &frame, vector<vector<Point>> &squares, double min_area) {
+    squares.clear();
+    const cv::UMat &image = frame.image();
+    vector<Mat> planes;
+    split(frame.smoothed(1), planes);
+    vector<vector<Point>> coarse;
+    findSquaresInPlanes(planes, COARSE_LEVEL_STEP, min_area / 4, coarse);
+
+    Rect bounds(Point(0, 0), image.size());
+    vector<Rect> regions;
+    for (const auto &square : coarse) {
+        Rect box = boundingRect(square);
+        box = Rect(box.x * 2, box.y * 2, box.width * 2, box.height * 2);
+        int dx = cvRound(box.width * REFINE_MARGIN);
+        int dy = cvRound(box.height * REFINE_MARGIN);
+        regions.push_back(Rect(box.x - dx, box.y - dy, box.width + 2 * dx, box.height + 2 * dy) & bounds);
+    }
+    mergeOverlapping(regions);
+
+    vector<vector<Point>> refined;
+    for (const Rect &region : regions) {
+        findSquares(image(region), refined, min_area);
+        for (auto &square : refined) {
+            for (Point &point : square) { point += region.tl(); }
+            squares.push_back(square);
+        }
+    }
+}
+
 // the function draws all the squares in the image
 static void drawSquares(cv::UMat &image, const vector<vector<Point>> &squares) {
     for (const auto &square : squares) {
@@ -97,8 +204,33 @@ static void drawSquares(cv::UMat &image, const vector<vector<Point>> &squares) {
     }
 }
 
-void Squares::modify(cv::UMat &img) {
-    vector<vector<Point>> squares;
-    findSquares(img, squares);
-    drawSquares(img, squares);
-}
\ No newline at end of file
+Squares::Squares(bool coarse_to_fine) :
+    m_coarse_to_fine(coarse_to_fine) {}
+
+void Squares::set_coarse_to_fine(bool coarse_to_fine) {
+    m_coarse_to_fine = coarse_to_fine;
+}
+
+void Squares::analyze(const FrameFeatures &frame, double scale) {
+    // Minimum area is 1000 pixels at full resolution
+    if (m_coarse_to_fine) {
+        findSquaresCoarseToFine(frame, m_squares, 1000 * scale * scale);
+    } else {
+        findSquares(frame, m_squares, 1000 * scale * scale);
+    }
+    for (auto &square : m_squares) {
+        scale_points(square, 1.0 / scale);
+    }
+}
+
+void Squares::draw(cv::UMat &img) {
+    drawSquares(img, m_squares);
+}
+
+void Squares::register_actions(ActionBox *box) {
+    ActionButton *coarse_button = box->add_action("Coarse to Fine");
+    coarse_button->setCheckable(true);
+    coarse_button->setChecked(m_coarse_to_fine);
+    connect(coarse_button, &QPushButton::toggled, this, &Squares::set_coarse_to_fine);
+    box->set_actions();
+}
@@ -1,11 +1,42 @@
 #ifndef MINOTAUR_SQUARES_H
 #define MINOTAUR_SQUARES_H
 
+#include <atomic>
+
 #include "modify.h"
 
+/**
+ * Detects squares by searching each color plane at many threshold levels.
+ * The planes and levels are searched concurrently on the worker pool.
+ *
+ * In coarse-to-fine mode, only a few levels are searched on the half
+ * resolution pyramid level, and every level is then searched only in
+ * the regions around the squares found there.
+ */
 class Squares : public VideoModifier {
 public:
-    void modify(cv::UMat &img) override;
+    explicit Squares(bool coarse_to_fine = false);
+
+    /**
+     * Switch between searching every threshold level on the whole
+     * frame and the coarse-to-fine search. Safe to call from any thread.
+     *
+     * @param coarse_to_fine whether to search coarse to fine
+     */
+    void set_coarse_to_fine(bool coarse_to_fine);
+
+    void analyze(const FrameFeatures &frame, double scale) override;
+
+    void draw(cv::UMat &img) override;
+
+    void register_actions(ActionBox *box) override;
+
+private:
+    /**
+     * Squares found by the last analysis, in full resolution coordinates.
+     */
+    std::vector<std::vector<cv::Point>> m_squares;
+    std::atomic<bool> m_coarse_to_fine;
 };
 
 
@@ -5,9 +5,12 @@
 #include <QPushButton>
 
 #include "tracker.h"
+#include "centroid.h"
 #include "../camera/actionbutton.h"
 #include "../compstate/compstate.h"
+#include "../compstate/parammanager.h"
 #include "../gui/global.h"
+#include "../utility/worker_pool.h"
 
 #ifndef NDEBUG
 
@@ -17,25 +20,71 @@
 
 // CMake will try to find goturn.caffemodel and goturn.prototxt, which need
 // to be added separately. If these are found, the GOTURN tracker model
-// will be used instead of the MIL tracker.
+// will be used instead of the KCF tracker.
 #ifdef GOTURN_FOUND
 #define TRACKER_TYPE Type::GOTURN
 #else
 #define TRACKER_TYPE Type::KCF
 #endif
 
-__tracker::__tracker() :
+namespace {
+    // Smallest normalized correlation at which a patch match is trusted
+    const double REACQUIRE_MIN_SCORE = 0.7;
+    // Least time between the starts of whole frame searches
+    const std::chrono::milliseconds REACQUIRE_INTERVAL(250);
+}
+
+__tracker::__tracker(int type) :
     m_bounding_box(),
-    m_type(TRACKER_TYPE),
+    m_scale(1.0),
+    m_patch_scale(1.0),
+    m_search_scale(1.0),
+    m_selection_requested(false),
+    m_selection_ready(false),
+    m_requests(NO_REQUEST),
+    m_type(type >= 0 && type < NUM_TYPES ? static_cast<Type>(type) : TRACKER_TYPE),
     m_state(State::UNINITIALIZED) {
     reset_tracker();
 }
 
+int __tracker::default_type() {
+    return TRACKER_TYPE;
+}
+
+const char *__tracker::type_name(int type) {
+    switch (type) {
+        case Type::BOOSTING:
+            return "Boosting";
+        case Type::MIL:
+            return "MIL";
+        case Type::KCF:
+            return "KCF";
+        case Type::TLD:
+            return "TLD";
+        case Type::MEDIAN_FLOW:
+            return "MedianFlow";
+        case Type::GOTURN:
+            return "GOTURN";
+        default:
+            return "Unknown";
+    }
+}
+
+void __tracker::set_type(int type) {
+    if (type < 0 || type >= NUM_TYPES || type == m_type) { return; }
+    m_type = static_cast<Type>(type);
+    if (m_state == State::TRACKING) { m_state = State::FAILED; }
+}
+
+void __tracker::track_box(const cv::Rect2d &box) {
+    QMutexLocker lock(&m_mutex);
+    m_requested_box = box;
+    m_requests |= TRACK_REQUEST;
+}
+
 void __tracker::reset_tracker() {
     m_mutex.lock();
-    // At this point MIL seems to be the best performing tracker
-    // Accuracy is more important than performance so long as
-    // framerate remains above at least 12
+    // Compare the trackers with minotaur-trackerbench
     switch (m_type) {
         case Type::BOOSTING:
             m_tracker = cv::TrackerBoosting::create();
@@ -65,44 +114,231 @@ void __tracker::reset_tracker() {
 }
 
 void __tracker::begin_tracking() {
-    if (m_state == State::UNINITIALIZED) {
-        m_state = State::FIRST_SCAN;
-    }
+    m_requests |= BEGIN_REQUEST;
 }
 
 void __tracker::stop_tracking() {
-    if (m_state != State::UNINITIALIZED) {
+    // Requests made before the stop are dropped
+    m_requests = STOP_REQUEST;
+}
+
+void __tracker::handle_requests() {
+    int requests = m_requests.exchange(NO_REQUEST);
+    if ((requests & STOP_REQUEST) && m_state != State::UNINITIALIZED) {
         reset_tracker();
         m_state = State::UNINITIALIZED;
         m_bounding_box = {};
+        m_filter.reset();
+    }
+    if (requests & TRACK_REQUEST) {
+        m_mutex.lock();
+        m_bounding_box = m_requested_box;
+        m_mutex.unlock();
+        m_filter.reset();
+        m_patch.release();
+        // Restarts at the box with this frame
+        m_state = State::FAILED;
+    }
+    if ((requests & BEGIN_REQUEST) && m_state == State::UNINITIALIZED) {
+        m_selection_requested = false;
+        m_selection_ready = false;
+        m_state = State::FIRST_SCAN;
     }
 }
 
-void __tracker::update_track(cv::UMat &img) {
-    if (m_state == State::FAILED) {
-        reset_tracker();
-        if (m_tracker->init(img, m_bounding_box)) {
-            m_state = State::TRACKING;
+cv::Rect __tracker::search_window(const cv::Rect2d &box, const cv::Size &size) {
+    cv::Point2d center = (box.tl() + box.br()) * 0.5;
+    double width = std::max(box.width * WINDOW_SCALE, static_cast<double>(MIN_WINDOW_SIZE));
+    double height = std::max(box.height * WINDOW_SCALE, static_cast<double>(MIN_WINDOW_SIZE));
+    cv::Rect window(
+        cvRound(center.x - width / 2), cvRound(center.y - height / 2),
+        cvRound(width), cvRound(height));
+    return window & cv::Rect(cv::Point(0, 0), size);
+}
+
+bool __tracker::init_window(const cv::UMat &img, const cv::Rect2d &box) {
+    m_window = search_window(box, img.size());
+    if (m_window.area() == 0) { return false; }
+    cv::Rect2d local(box.x - m_window.x, box.y - m_window.y, box.width, box.height);
+    return m_tracker->init(img(m_window), local);
+}
+
+void __tracker::select_region(const cv::UMat &frame, double scale) {
+    cv::Rect2d box = cv::selectROI(frame);
+    QMutexLocker lock(&m_mutex);
+    if (m_state != State::FIRST_SCAN) { return; }
+    if (box.area() > 0) { store_patch(frame, box, scale); }
+    m_selection = VideoModifier::scale_rect(box, 1.0 / scale);
+    m_selection_ready = true;
+}
+
+void __tracker::first_scan(const cv::UMat &img, double scale) {
+    if (!m_selection_requested) {
+        // Select on a copy, since the frame is drawn on after analysis
+        m_selection_requested = true;
+        QMetaObject::invokeMethod(this, "select_region", Qt::QueuedConnection,
+                                  Q_ARG(cv::UMat, img.clone()), Q_ARG(double, scale));
+        return;
+    }
+    m_mutex.lock();
+    bool ready = m_selection_ready;
+    cv::Rect2d box = m_selection;
+    m_mutex.unlock();
+    if (!ready) { return; }
+    m_selection_requested = false;
+    m_selection_ready = false;
+    // The selection was cancelled
+    if (box.area() <= 0) {
+        m_state = State::UNINITIALIZED;
+        return;
+    }
+    m_filter.reset();
+    restart(img, scale, box);
+}
+
+void __tracker::restart(const cv::UMat &img, double scale, const cv::Rect2d &box) {
+    reset_tracker();
+    m_scale = scale;
+    cv::Rect2d local = VideoModifier::scale_rect(box, scale);
+    // A box given by track_box() has no patch to re-acquire with yet
+    if (m_patch.empty()) { store_patch(img, local, scale); }
+    if (init_window(img, local)) {
+        m_bounding_box = box;
+        m_state = State::TRACKING;
+    } else {
+        begin_reacquire(img, scale);
+    }
+}
+
+void __tracker::store_patch(const cv::UMat &img, const cv::Rect2d &box, double scale) {
+    cv::Rect region = cv::Rect(box) & cv::Rect(cv::Point(0, 0), img.size());
+    if (region.area() == 0) { return; }
+    img(region).copyTo(m_patch);
+    m_patch_scale = scale;
+}
+
+__tracker::Match __tracker::match_patch(const cv::Mat &frame, const cv::Mat &patch) {
+    if (patch.empty() || patch.cols > frame.cols || patch.rows > frame.rows) {
+        return {cv::Rect2d(), 0};
+    }
+    cv::Mat score;
+    cv::matchTemplate(frame, patch, score, cv::TM_CCOEFF_NORMED);
+    double best = 0;
+    cv::Point loc;
+    cv::minMaxLoc(score, nullptr, &best, nullptr, &loc);
+    return {cv::Rect2d(loc.x, loc.y, patch.cols, patch.rows), best};
+}
+
+void __tracker::begin_reacquire(const cv::UMat &img, double scale) {
+    if (m_patch.empty()) {
+        // Nothing to search for, ask the user again
+        m_selection_requested = false;
+        m_selection_ready = false;
+        m_state = State::FIRST_SCAN;
+        return;
+    }
+    m_state = State::REACQUIRING;
+    // The search is over the whole frame, so while the target is
+    // missing it is started again only once the interval has passed
+    pipeline_clock::time_point now = pipeline_clock::now();
+    if (now - m_search_started < REACQUIRE_INTERVAL) { return; }
+    m_search_started = now;
+    cv::Mat frame;
+    img.copyTo(frame);
+    cv::Mat patch = m_patch;
+    if (scale != m_patch_scale) {
+        cv::resize(m_patch, patch, cv::Size(), scale / m_patch_scale, scale / m_patch_scale);
+    }
+    m_search_scale = scale;
+    // Search off the tracking thread so the pipeline keeps running
+    m_search = std::async(std::launch::async, &__tracker::match_patch, frame, patch);
+}
+
+void __tracker::reacquire(const cv::UMat &img, double scale) {
+    if (!m_search.valid()) {
+        begin_reacquire(img, scale);
+        return;
+    }
+    if (m_search.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { return; }
+    Match match = m_search.get();
+    if (match.score < REACQUIRE_MIN_SCORE) {
+        // Search again in this or a later frame
+        begin_reacquire(img, scale);
+        return;
+    }
+    m_filter.reset();
+    restart(img, scale, VideoModifier::scale_rect(match.box, 1.0 / m_search_scale));
+}
+
+void __tracker::update_track(const cv::UMat &img, double scale) {
+    pipeline_clock::time_point now = pipeline_clock::now();
+    handle_requests();
+    if (m_state == State::FIRST_SCAN) {
+        first_scan(img, scale);
+        return;
+    }
+    if (m_state == State::REACQUIRING) {
+        reacquire(img, scale);
+        return;
+    }
+    // The tracker model is tied to the scale it was initialized at
+    if (m_state == State::TRACKING && scale != m_scale) {
+        m_state = State::FAILED;
+    }
+    // Move the search window when the target is expected to leave it
+    if (m_state == State::TRACKING && m_filter.motion().valid) {
+        cv::Rect2d predicted = VideoModifier::scale_rect(m_filter.motion().predict(now), scale);
+        cv::Rect2d window = m_window;
+        if ((predicted & window) != predicted) {
+            m_state = State::FAILED;
         }
+    }
+    if (m_state == State::FAILED) {
+        // Restart where the target is expected to be by now
+        restart(img, scale, m_filter.motion().valid ? m_filter.motion().predict(now) : m_bounding_box);
         return;
     }
-    if (m_state != State::UNINITIALIZED) {
+    if (m_state == State::TRACKING) {
         m_mutex.lock();
-        if (m_state == State::TRACKING) {
-            if (!m_tracker->update(img, m_bounding_box)) {
-                m_state = State::FAILED;
-            }
-        } else if (m_state == State::FIRST_SCAN) {
-            m_bounding_box = cv::selectROI(img);
-            if (m_tracker->init(img, m_bounding_box)) {
-                m_state = State::TRACKING;
-            } else {
-                m_state = State::FAILED;
-            }
+        cv::Rect2d box;
+        // Only search the window around the target
+        bool measured = m_tracker->update(img(m_window), box);
+        box.x += m_window.x;
+        box.y += m_window.y;
+        if (measured) {
+            store_patch(img, box, scale);
+            m_filter.update(VideoModifier::scale_rect(box, 1.0 / scale), now);
+            m_bounding_box = m_filter.motion().box;
         }
         m_mutex.unlock();
+        if (!measured) {
+            // Look for the target instead of restarting at a stale box
+            begin_reacquire(img, scale);
+            return;
+        }
         Q_EMIT target_box(m_bounding_box);
+        cv::Point2d center;
+        if (g_pm && g_pm->centroid_refine && contrast_centroid(img, box, center)) {
+            // Carry the centroid's offset within the measured box over to
+            // the filtered box, so that the center is filtered as well
+            cv::Point2d offset = (center - (box.tl() + box.br()) * 0.5) * (1.0 / scale);
+            Q_EMIT target_center((m_bounding_box.tl() + m_bounding_box.br()) * 0.5 + offset);
+        }
+        Q_EMIT target_motion(m_filter.motion());
+    }
+}
+
+void __tracker::update_flow(const cv::UMat &gray, double scale, pipeline_clock::time_point time) {
+    if (m_state != State::TRACKING) {
+        m_flow.reset();
+        return;
     }
+    TargetFlow flow = m_flow.update(gray, m_bounding_box, scale, time);
+    if (flow.valid) { Q_EMIT target_flow(flow); }
+}
+
+void __tracker::confirm() {
+    if (m_state == State::TRACKING) { Q_EMIT target_confirmed(); }
 }
 
 void __tracker::draw_bounding_box(cv::UMat &img) {
@@ -115,12 +351,30 @@ __tracker::State __tracker::state() const {
     return m_state;
 }
 
+bool __tracker::needs_frame() const {
+    if (m_requests != NO_REQUEST) { return true; }
+    State state = m_state;
+    return state == State::FIRST_SCAN || state == State::FAILED || state == State::REACQUIRING;
+}
+
+cv::Rect2d __tracker::bounding_box() const {
+    return m_bounding_box;
+}
+
 TrackerModifier::TrackerModifier() :
     m_robot_tracker(),
     m_object_tracker() {
     CompetitionState *state = &Main::get()->state();
     connect(&m_robot_tracker, &__tracker::target_box, state, &CompetitionState::acquire_robot_box);
     connect(&m_object_tracker, &__tracker::target_box, state, &CompetitionState::acquire_object_box);
+    connect(&m_robot_tracker, &__tracker::target_center, state, &CompetitionState::acquire_robot_center);
+    connect(&m_object_tracker, &__tracker::target_center, state, &CompetitionState::acquire_object_center);
+    connect(&m_robot_tracker, &__tracker::target_motion, state, &CompetitionState::acquire_robot_motion);
+    connect(&m_object_tracker, &__tracker::target_motion, state, &CompetitionState::acquire_object_motion);
+    connect(&m_robot_tracker, &__tracker::target_flow, state, &CompetitionState::acquire_robot_flow);
+    connect(&m_object_tracker, &__tracker::target_flow, state, &CompetitionState::acquire_object_flow);
+    connect(&m_robot_tracker, &__tracker::target_confirmed, state, &CompetitionState::confirm_robot_box);
+    connect(&m_object_tracker, &__tracker::target_confirmed, state, &CompetitionState::confirm_object_box);
 }
 
 void TrackerModifier::traverse() {
@@ -156,9 +410,38 @@ void TrackerModifier::register_actions(ActionBox *box) {
     box->set_actions();
 }
 
-void TrackerModifier::modify(cv::UMat &img) {
-    m_robot_tracker.update_track(img);
-    m_object_tracker.update_track(img);
+void TrackerModifier::analyze(const FrameFeatures &frame, double scale) {
+    if (g_pm && g_pm->tracker_type >= 0) {
+        m_robot_tracker.set_type(g_pm->tracker_type);
+        m_object_tracker.set_type(g_pm->tracker_type);
+    }
+    // The trackers share only the frame, so update them concurrently;
+    // run() returns once both are done. The OpenCV trackers take the
+    // color frame and convert it themselves; the flow shares the gray one.
+    const cv::UMat &img = frame.image();
+    std::vector<worker_pool::task> tasks{
+        [this, &img, &frame, scale] {
+            m_robot_tracker.update_track(img, scale);
+            m_robot_tracker.update_flow(frame.gray(), scale, frame.captured());
+        },
+        [this, &img, &frame, scale] {
+            m_object_tracker.update_track(img, scale);
+            m_object_tracker.update_flow(frame.gray(), scale, frame.captured());
+        }
+    };
+    worker_pool::shared().run(tasks);
+}
+
+void TrackerModifier::reuse() {
+    m_robot_tracker.confirm();
+    m_object_tracker.confirm();
+}
+
+bool TrackerModifier::needs_analysis() const {
+    return m_robot_tracker.needs_frame() || m_object_tracker.needs_frame();
+}
+
+void TrackerModifier::draw(cv::UMat &img) {
     m_robot_tracker.draw_bounding_box(img);
     m_object_tracker.draw_bounding_box(img);
 }
@@ -2,10 +2,14 @@
 #define MINOTAUR_CPP_TRACKER_H
 #ifndef TRACKER_OFF
 
+#include "boxfilter.h"
+#include "flowvelocity.h"
 #include "modify.h"
 #include "../compstate/procedure.h"
 #include <opencv2/tracking.hpp>
 #include <QMutex>
+#include <atomic>
+#include <future>
 
 class QVBoxLayout;
 class QPushButton;
@@ -18,7 +22,17 @@ public:
         UNINITIALIZED,
         FIRST_SCAN,
         TRACKING,
-        FAILED
+        // The tracker is restarted at the predicted box
+        FAILED,
+        // The target is being searched for in the whole frame
+        REACQUIRING
+    };
+
+    enum {
+        // Search window size relative to the target box
+        WINDOW_SCALE = 3,
+        // Smallest search window side in analysis pixels
+        MIN_WINDOW_SIZE = 32
     };
 
     enum Type {
@@ -27,51 +41,294 @@ public:
         KCF,
         TLD,
         MEDIAN_FLOW,
-        GOTURN
+        GOTURN,
+        NUM_TYPES
     };
 
-    __tracker();
+    /**
+     * @param type one of Type
+     */
+    explicit __tracker(int type = default_type());
+
+    /**
+     * @return GOTURN if its model files were found at build time, otherwise KCF
+     */
+    static int default_type();
+
+    static const char *type_name(int type);
 
-    void update_track(cv::UMat &img);
+    /**
+     * Update the tracker with an analysis frame. The bounding box is
+     * kept in full resolution coordinates, and the tracker is
+     * reinitialized when the analysis scale changes.
+     *
+     * The tracker only searches a window around the target, which is
+     * moved when the filtered motion predicts the target will leave it.
+     *
+     * The first region is selected by the user on the thread the tracker
+     * lives in, without holding up the caller. When the tracker loses the
+     * target, the last good patch of the target is searched for in the
+     * whole frame in the background, and the tracker restarts once it is
+     * found with enough confidence.
+     *
+     * @param img   analysis frame
+     * @param scale scale of the analysis frame relative to the full frame
+     */
+    void update_track(const cv::UMat &img, double scale);
+
+    /**
+     * Measure the motion of the tracked target since the last frame
+     * by optical flow inside its box. Call after update_track().
+     *
+     * @param gray  grayscale analysis frame
+     * @param scale scale of the analysis frame relative to the full frame
+     * @param time  time at which the frame was captured
+     */
+    void update_flow(const cv::UMat &gray, double scale, pipeline_clock::time_point time);
 
     void draw_bounding_box(cv::UMat &img);
 
     State state() const;
 
+    /**
+     * @return whether the tracker has to see the next frame to make
+     *         progress, even if it is unchanged
+     */
+    bool needs_frame() const;
+
+    /**
+     * @return the filtered target box in full resolution coordinates
+     */
+    cv::Rect2d bounding_box() const;
+
+    /**
+     * Emitted with the filtered box of the target after each measurement.
+     */
     Q_SIGNAL void target_box(const cv::Rect2d &box);
 
+    /**
+     * Emitted after the box with the subpixel centroid of the target
+     * in full resolution coordinates, when centroid refinement is on.
+     * The centroid is placed within the filtered box as it was found
+     * within the measured one.
+     */
+    Q_SIGNAL void target_center(const cv::Point2d &center);
+
+    /**
+     * Emitted with the filtered motion of the target after each measurement.
+     */
+    Q_SIGNAL void target_motion(const TargetMotion &motion);
+
+    /**
+     * Emitted with the optical flow of the target between tracked frames.
+     */
+    Q_SIGNAL void target_flow(const TargetFlow &flow);
+
+    /**
+     * Emitted by confirm() when the last box still holds.
+     */
+    Q_SIGNAL void target_confirmed();
+
+    /**
+     * Confirm the last box for a frame unchanged from the last
+     * tracked one, if the target is being tracked.
+     */
+    void confirm();
+
+    /**
+     * Ask the user for a target with the next frame, if not tracking.
+     * Like stop_tracking() and track_box(), the request is only recorded,
+     * and is carried out by update_track() on the tracking thread.
+     */
     Q_SLOT void begin_tracking();
 
+    /**
+     * Stop tracking with the next frame, dropping earlier requests.
+     */
     Q_SLOT void stop_tracking();
 
+    /**
+     * Start tracking a known box with the next frame instead of asking
+     * the user for one.
+     *
+     * @param box target box in full resolution coordinates
+     */
+    Q_SLOT void track_box(const cv::Rect2d &box);
+
+    /**
+     * Change the tracker algorithm. A running tracker restarts
+     * with the new algorithm at the predicted target box. Must be
+     * called on the thread that updates the tracker.
+     *
+     * @param type one of Type
+     */
+    void set_type(int type);
+
 private:
+    /**
+     * Result of a search for the target patch.
+     */
+    struct Match {
+        cv::Rect2d box;
+        double score;
+    };
+
+    /**
+     * Requests made from other threads, handled by the next update.
+     */
+    enum Request {
+        NO_REQUEST = 0,
+        BEGIN_REQUEST = 1,
+        STOP_REQUEST = 2,
+        TRACK_REQUEST = 4
+    };
+
+    /**
+     * Let the user select the target in a frame. Runs on the thread
+     * the tracker lives in.
+     *
+     * @param frame copy of the analysis frame
+     * @param scale scale of the frame relative to the full frame
+     */
+    Q_SLOT void select_region(const cv::UMat &frame, double scale);
+
     void reset_tracker();
 
+    /**
+     * Carry out the pending stop, track and begin requests, in that order.
+     */
+    void handle_requests();
+
+    /**
+     * Request a selection from the user and start tracking once it is made.
+     */
+    void first_scan(const cv::UMat &img, double scale);
+
+    /**
+     * Initialize a new tracker at a box, or start searching for the
+     * target if that fails.
+     *
+     * @param box target box in full resolution coordinates
+     */
+    void restart(const cv::UMat &img, double scale, const cv::Rect2d &box);
+
+    /**
+     * Start searching for the target patch in the frame, unless the last
+     * search was started less than the search interval ago, in which case
+     * reacquire() starts it with a later frame.
+     */
+    void begin_reacquire(const cv::UMat &img, double scale);
+
+    /**
+     * Restart the tracker if the search found the target, or search again.
+     */
+    void reacquire(const cv::UMat &img, double scale);
+
+    /**
+     * Keep the patch under a box as the template for re-acquisition.
+     */
+    void store_patch(const cv::UMat &img, const cv::Rect2d &box, double scale);
+
+    static Match match_patch(const cv::Mat &frame, const cv::Mat &patch);
+
+    /**
+     * Search window around a box in analysis coordinates, clipped to the frame.
+     */
+    static cv::Rect search_window(const cv::Rect2d &box, const cv::Size &size);
+
+    /**
+     * Center the search window on a box and initialize the tracker in it.
+     *
+     * @param img analysis frame
+     * @param box target box in analysis coordinates
+     * @return whether the tracker was initialized
+     */
+    bool init_window(const cv::UMat &img, const cv::Rect2d &box);
+
 private:
     cv::Ptr<cv::Tracker> m_tracker;
+    /**
+     * Bounding box in full resolution coordinates.
+     */
     cv::Rect2d m_bounding_box;
+    /**
+     * Analysis scale the tracker was initialized at.
+     */
+    double m_scale;
+    /**
+     * Search window in analysis coordinates.
+     */
+    cv::Rect m_window;
+    /**
+     * Motion filter over the measured boxes, in full resolution coordinates.
+     */
+    BoxFilter m_filter;
+    /**
+     * Optical flow of the target between tracked frames.
+     */
+    FlowVelocity m_flow;
+
+    /**
+     * Last good patch of the target and the scale it was taken at.
+     */
+    cv::Mat m_patch;
+    double m_patch_scale;
+    /**
+     * Background search for the patch, the scale of the searched frame,
+     * and when the search was started.
+     */
+    std::future<Match> m_search;
+    double m_search_scale;
+    pipeline_clock::time_point m_search_started;
+
+    /**
+     * Region selected by the user, in full resolution coordinates,
+     * waiting to be picked up by the tracking thread.
+     */
+    bool m_selection_requested;
+    bool m_selection_ready;
+    cv::Rect2d m_selection;
+
+    /**
+     * Pending Request flags, and the box of a track request.
+     */
+    std::atomic<int> m_requests;
+    cv::Rect2d m_requested_box;
 
     Type m_type;
-    State m_state;
+    /**
+     * Written only on the tracking thread, read on others.
+     */
+    std::atomic<State> m_state;
 
     /**
-     * Class mutex instance used to prevent a scenario wherein
-     * the class's cv::Tracker pointer is set to null while another
-     * thread tries to use it, resulting in a segmentation fault.
-     *
-     * Might happen when clicking "Clear ROI", because reset_tracker() and
-     * modify() are called in different threads.
+     * Guards the selection and the requested box, which are written on
+     * other threads than the tracking one, and the tracker pointer.
      */
     QMutex m_mutex;
 };
 
+/**
+ * Tracks the robot and the object, each with its own tracker. Both
+ * trackers are updated concurrently on the shared worker pool.
+ */
 class TrackerModifier : public VideoModifier {
 Q_OBJECT
 
 public:
     TrackerModifier();
 
-    void modify(cv::UMat &img) override;
+    void analyze(const FrameFeatures &frame, double scale) override;
+
+    void draw(cv::UMat &img) override;
+
+    void reuse() override;
+
+    /**
+     * @return whether either tracker is waiting for a selection,
+     *         restarting, or searching for its target
+     */
+    bool needs_analysis() const override;
 
     void register_actions(ActionBox *box) override;
 
@@ -0,0 +1,123 @@
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+
+#include "walldetect.h"
+#include "../camera/actionbutton.h"
+#include "../compstate/parammanager.h"
+#include "../gui/global.h"
+#include "../gui/griddisplay.h"
+#include "../utility/array2d.h"
+
+namespace {
+    // Used when there are no runtime parameters, such as when headless
+    const int DEFAULT_GRAY_MIN = 0;
+    const int DEFAULT_GRAY_MAX = 60;
+    const double DEFAULT_CELL_FILL = 0.5;
+    const double DEFAULT_CELL_CHANGE = 8.0;
+}
+
+bool WallDetect::Thresholds::operator!=(const Thresholds &o) const {
+    return gray_min != o.gray_min || gray_max != o.gray_max || cell_fill != o.cell_fill;
+}
+
+WallDetect::Thresholds WallDetect::thresholds() {
+    if (!g_pm) { return {DEFAULT_GRAY_MIN, DEFAULT_GRAY_MAX, DEFAULT_CELL_FILL}; }
+    return {g_pm->wall_gray_min, g_pm->wall_gray_max, g_pm->wall_cell_fill};
+}
+
+WallDetect::WallDetect() :
+    m_scale(1.0),
+    m_thresholds(thresholds()),
+    m_reset(false),
+    m_recomputed(0) {
+    if (!Main::get()) { return; }
+    connect(this, &WallDetect::walls_changed, &Main::get()->state(), &CompetitionState::acquire_walls);
+}
+
+cv::Rect WallDetect::cell_rect(int x, int y, double scale, const cv::Size &size) {
+    // Cells are a fixed size at full resolution
+    double cell = GridDisplay::grid_size() * scale;
+    cv::Point tl(cvRound(x * cell), cvRound(y * cell));
+    cv::Point br(cvRound((x + 1) * cell), cvRound((y + 1) * cell));
+    return cv::Rect(tl, br) & cv::Rect(cv::Point(0, 0), size);
+}
+
+bool WallDetect::needs_full(const cv::Size &size, double scale, const Thresholds &t) const {
+    return m_reference.size() != size || m_scale != scale || m_thresholds != t;
+}
+
+void WallDetect::analyze(const FrameFeatures &frame, double scale) {
+    const cv::UMat &img = frame.gray();
+    Thresholds t = thresholds();
+    double change = g_pm ? g_pm->wall_cell_change : DEFAULT_CELL_CHANGE;
+    bool full = m_reset.exchange(false) || needs_full(img.size(), scale, t);
+    if (full) {
+        // Cover the full resolution frame with whole cells
+        int cell = GridDisplay::grid_size();
+        int cols = static_cast<int>(std::ceil(img.cols / scale / cell));
+        int rows = static_cast<int>(std::ceil(img.rows / scale / cell));
+        m_cells = cv::Mat::zeros(rows, cols, CV_8U);
+        m_reference.create(img.size(), CV_8U);
+        m_scale = scale;
+        m_thresholds = t;
+    }
+
+    cv::Mat gray = img.getMat(cv::ACCESS_READ);
+    cv::Mat mask;
+    bool changed = full;
+    m_recomputed = 0;
+    for (int y = 0; y < m_cells.rows; ++y) {
+        for (int x = 0; x < m_cells.cols; ++x) {
+            cv::Rect r = cell_rect(x, y, scale, gray.size());
+            if (r.area() == 0) { continue; }
+            cv::Mat cell = gray(r);
+            // Skip cells that look the same as when they were classified
+            if (!full && cv::norm(cell, m_reference(r), cv::NORM_L1) <= change * r.area()) { continue; }
+            cv::inRange(cell, cv::Scalar(t.gray_min), cv::Scalar(t.gray_max), mask);
+            uchar wall = cv::countNonZero(mask) >= t.cell_fill * r.area();
+            changed = changed || wall != m_cells.at<uchar>(y, x);
+            m_cells.at<uchar>(y, x) = wall;
+            cell.copyTo(m_reference(r));
+            ++m_recomputed;
+        }
+    }
+    if (changed) { publish(); }
+}
+
+void WallDetect::publish() {
+    // Each grid is handed off whole, since it is read on another thread
+    auto walls = std::make_shared<wall_arr>(m_cells.cols, m_cells.rows);
+    for (int y = 0; y < m_cells.rows; ++y) {
+        const uchar *row = m_cells.ptr<uchar>(y);
+        for (int x = 0; x < m_cells.cols; ++x) {
+            (*walls)[x][y] = row[x] != 0;
+        }
+    }
+    Q_EMIT walls_changed(walls);
+}
+
+void WallDetect::draw(cv::UMat &img) {
+    int cell = GridDisplay::grid_size();
+    for (int y = 0; y < m_cells.rows; ++y) {
+        const uchar *row = m_cells.ptr<uchar>(y);
+        for (int x = 0; x < m_cells.cols; ++x) {
+            if (row[x]) {
+                cv::rectangle(img, cv::Rect(x * cell, y * cell, cell, cell), cv::Scalar(0, 0, 255));
+            }
+        }
+    }
+}
+
+int WallDetect::recomputed() const {
+    return m_recomputed;
+}
+
+void WallDetect::recompute_all() {
+    m_reset = true;
+}
+
+void WallDetect::register_actions(ActionBox *box) {
+    ActionButton *recompute_button = box->add_action("Recompute Walls");
+    connect(recompute_button, &QPushButton::clicked, this, &WallDetect::recompute_all);
+    box->set_actions();
+}
@@ -0,0 +1,92 @@
+#ifndef MINOTAUR_CPP_WALLDETECT_H
+#define MINOTAUR_CPP_WALLDETECT_H
+
+#include "modify.h"
+#include "../compstate/compstate.h"
+
+#include <atomic>
+
+/**
+ * Builds the wall occupancy grid from the frame, instead of walls
+ * being selected by hand on the GridDisplay.
+ *
+ * The frame is divided into cells of the GridDisplay size, in full
+ * resolution pixels, and a cell is a wall when enough of its pixels
+ * fall in the wall gray level range. Only cells whose pixels changed
+ * since they were last classified are classified again, so a still
+ * camera costs a frame difference. A new grid is published to
+ * CompetitionState whenever a cell changes between wall and floor, and
+ * the GridDisplay marks its cells over the detected walls, so that the
+ * A* path is planned around them.
+ */
+class WallDetect : public VideoModifier {
+Q_OBJECT
+
+public:
+    typedef CompetitionState::wall_arr wall_arr;
+
+    WallDetect();
+
+    void analyze(const FrameFeatures &frame, double scale) override;
+
+    void draw(cv::UMat &img) override;
+
+    void register_actions(ActionBox *box) override;
+
+    /**
+     * @return the number of cells classified by the last analysis
+     */
+    int recomputed() const;
+
+    /**
+     * Emitted with a new grid, indexed by cell column then row,
+     * whenever any cell changes.
+     */
+    Q_SIGNAL void walls_changed(const std::shared_ptr<CompetitionState::wall_arr> &walls);
+
+    /**
+     * Classify every cell with the next frame.
+     */
+    Q_SLOT void recompute_all();
+
+private:
+    /**
+     * Classification parameters, all cells are classified again when they change.
+     */
+    struct Thresholds {
+        int gray_min;
+        int gray_max;
+        double cell_fill;
+
+        bool operator!=(const Thresholds &o) const;
+    };
+
+    static Thresholds thresholds();
+
+    /**
+     * Cell in analysis coordinates, clipped to the frame.
+     */
+    static cv::Rect cell_rect(int x, int y, double scale, const cv::Size &size);
+
+    /**
+     * Whether the cells are invalid for a frame, in which case all are classified.
+     */
+    bool needs_full(const cv::Size &size, double scale, const Thresholds &t) const;
+
+    void publish();
+
+    /**
+     * Gray levels of each cell as of when it was last classified.
+     */
+    cv::Mat m_reference;
+    /**
+     * Nonzero for wall cells, one row per grid row.
+     */
+    cv::Mat m_cells;
+    double m_scale;
+    Thresholds m_thresholds;
+    std::atomic<bool> m_reset;
+    int m_recomputed;
+};
+
+#endif //MINOTAUR_CPP_WALLDETECT_H
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <opencv2/calib3d.hpp>
+
+#include <code/camera/calibration.h>
+
+#include <cstdio>
+
+static const cv::Size SIZE(640, 480);
+
+static const cv::Matx33d CAMERA(600, 0, 320,
+                                0, 600, 240,
+                                0, 0, 1);
+
+static const cv::Matx33d HOMOGRAPHY(0.5, 0.1, -20,
+                                    0.0, 0.6, -10,
+                                    0.0, 0.0005, 1);
+
+TEST(camera_calibration, maps_to_field_and_back) {
+    cv::Mat distortion = (cv::Mat_<double>(1, 5) << -0.2, 0.05, 0, 0, 0);
+    CameraCalibration calibration(SIZE, CAMERA, distortion, HOMOGRAPHY);
+    cv::Point2d raw(500, 90);
+    cv::Point2d field = calibration.raw_to_field(raw, SIZE);
+    cv::Point2d undistorted = calibration.from_field(field, SIZE);
+    // Undistortion moves a point near the corner outwards
+    ASSERT_GT(cv::norm(undistorted - raw), 1.0);
+    ASSERT_NEAR(calibration.undistort(raw, SIZE).x, undistorted.x, 1e-6);
+    ASSERT_NEAR(calibration.undistort(raw, SIZE).y, undistorted.y, 1e-6);
+
+    // The derivative predicts a small step
+    cv::Point2d step(2, -1);
+    cv::Point2d predicted = field + calibration.raw_to_field_jacobian(raw, SIZE) * step;
+    cv::Point2d actual = calibration.raw_to_field(raw + step, SIZE);
+    ASSERT_NEAR(predicted.x, actual.x, 1e-2);
+    ASSERT_NEAR(predicted.y, actual.y, 1e-2);
+}
+
+TEST(camera_calibration, maps_frames_of_another_size) {
+    cv::Mat distortion = (cv::Mat_<double>(1, 5) << -0.2, 0.05, 0, 0, 0);
+    CameraCalibration calibration(SIZE, CAMERA, distortion, HOMOGRAPHY);
+    const cv::Size frame(1280, 960);
+    cv::Point2d raw(500, 90);
+    cv::Point2d scaled(raw.x * 2, raw.y * 2);
+    // The same place in a frame of twice the size maps to the same field point
+    cv::Point2d expected = calibration.raw_to_field(raw, SIZE);
+    cv::Point2d field = calibration.raw_to_field(scaled, frame);
+    ASSERT_NEAR(expected.x, field.x, 1e-6);
+    ASSERT_NEAR(expected.y, field.y, 1e-6);
+    cv::Rect2d box = calibration.raw_to_field(cv::Rect2d(scaled, cv::Size2d(40, 20)), frame);
+    cv::Rect2d expected_box = calibration.raw_to_field(cv::Rect2d(raw, cv::Size2d(20, 10)), SIZE);
+    ASSERT_NEAR(expected_box.x, box.x, 1e-6);
+    ASSERT_NEAR(expected_box.width, box.width, 1e-6);
+    // and back to the undistorted point in the larger frame
+    cv::Point2d undistorted = calibration.from_field(field, frame);
+    ASSERT_NEAR(calibration.undistort(scaled, frame).x, undistorted.x, 1e-6);
+    ASSERT_NEAR(calibration.undistort(scaled, frame).y, undistorted.y, 1e-6);
+
+    // which is where the undistortion tables for that size look up the raw point
+    cv::Mat map_x;
+    cv::Mat map_y;
+    calibration.undistort_maps(frame, map_x, map_y);
+    cv::Point p(cvRound(undistorted.x), cvRound(undistorted.y));
+    ASSERT_NEAR(scaled.x, map_x.at<float>(p), 2.0);
+    ASSERT_NEAR(scaled.y, map_y.at<float>(p), 2.0);
+}
+
+TEST(camera_calibration, saves_and_loads) {
+    cv::Mat distortion = (cv::Mat_<double>(1, 5) << -0.2, 0.05, 0, 0, 0);
+    CameraCalibration calibration(SIZE, CAMERA, distortion, HOMOGRAPHY);
+    const char *file = "calibration_test.yml";
+    ASSERT_TRUE(calibration.save(file));
+    std::shared_ptr<CameraCalibration> loaded = CameraCalibration::load(file);
+    std::remove(file);
+    ASSERT_NE(nullptr, loaded);
+    ASSERT_EQ(SIZE, loaded->size());
+    cv::Point2d a = calibration.raw_to_field(cv::Point2d(100, 400), SIZE);
+    cv::Point2d b = loaded->raw_to_field(cv::Point2d(100, 400), SIZE);
+    ASSERT_NEAR(a.x, b.x, 1e-9);
+    ASSERT_NEAR(a.y, b.y, 1e-9);
+    ASSERT_EQ(nullptr, CameraCalibration::load("missing_calibration.yml"));
+}
+
+TEST(camera_calibration, estimates_from_chessboard) {
+    const cv::Size board(9, 6);
+    const double square = 25.0;
+    std::vector<cv::Point3d> corners;
+    for (int r = 0; r < board.height; ++r) {
+        for (int c = 0; c < board.width; ++c) { corners.emplace_back(c * square, r * square, 0); }
+    }
+    // Views of the board tilted by different amounts, the last flat on the field
+    const double tilts[][3] = {{0.3, 0.1, 0}, {-0.3, 0.2, 0.1}, {0.1, -0.4, 0}, {0.2, 0.3, -0.2}, {0.05, 0.05, 0.02}};
+    std::vector<std::vector<cv::Point2f>> views;
+    cv::Mat distortion = (cv::Mat_<double>(1, 5) << -0.1, 0.01, 0, 0, 0);
+    for (const auto &tilt : tilts) {
+        std::vector<cv::Point2d> projected;
+        cv::projectPoints(corners, cv::Vec3d(tilt[0], tilt[1], tilt[2]), cv::Vec3d(-100, -60, 600),
+                          CAMERA, distortion, projected);
+        views.emplace_back(projected.begin(), projected.end());
+    }
+    std::shared_ptr<CameraCalibration> calibration =
+        CameraCalibration::from_chessboard(views, SIZE, board, square);
+    ASSERT_NE(nullptr, calibration);
+    // Corners of the last view map to their place on the board
+    for (int i : {0, 8, 45, 53}) {
+        cv::Point2d field = calibration->raw_to_field(cv::Point2d(views.back()[i]), SIZE);
+        ASSERT_NEAR(corners[i].x, field.x, 0.5);
+        ASSERT_NEAR(corners[i].y, field.y, 0.5);
+    }
+    // Too few views
+    views.resize(2);
+    ASSERT_EQ(nullptr, CameraCalibration::from_chessboard(views, SIZE, board, square));
+}
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc.hpp>
+
+#include <code/camera/framegate.h>
+#include <test/testframe.h>
+
+static cv::UMat scene(int robot_x) {
+    return test_frame(cv::Size(640, 480), CV_8UC3, cv::Scalar::all(0), [robot_x](cv::Mat &frame) {
+        cv::rectangle(frame, cv::Rect(robot_x, 200, 16, 16), cv::Scalar(68, 196, 98), cv::FILLED);
+    });
+}
+
+TEST(frame_gate, skips_unchanged_frames) {
+    FrameGate gate;
+    ASSERT_TRUE(gate.changed(scene(112), 4.0, 100));
+    ASSERT_FALSE(gate.changed(scene(112), 4.0, 100));
+    // A move of a few pixels changes the means of the blocks it spans
+    ASSERT_TRUE(gate.changed(scene(115), 4.0, 100));
+    ASSERT_FALSE(gate.changed(scene(115), 4.0, 100));
+}
+
+TEST(frame_gate, compares_against_last_analyzed_frame) {
+    FrameGate gate;
+    ASSERT_TRUE(gate.changed(scene(112), 10.0, 100));
+    // Each single pixel step is below the threshold, but they add up
+    ASSERT_FALSE(gate.changed(scene(113), 10.0, 100));
+    ASSERT_TRUE(gate.changed(scene(114), 10.0, 100));
+}
+
+TEST(frame_gate, limits_reuse_and_resets) {
+    FrameGate gate;
+    ASSERT_TRUE(gate.changed(scene(100), 4.0, 2));
+    ASSERT_FALSE(gate.changed(scene(100), 4.0, 2));
+    ASSERT_FALSE(gate.changed(scene(100), 4.0, 2));
+    ASSERT_TRUE(gate.changed(scene(100), 4.0, 2));
+    gate.reset();
+    ASSERT_TRUE(gate.changed(scene(100), 4.0, 2));
+    // Disabled
+    ASSERT_TRUE(gate.changed(scene(100), 0.0, 2));
+}
@@ -28,3 +28,37 @@ TEST(direct_movement, find_path) {
     ASSERT_EQ(path.at(6), p7);
 }
 
+TEST(direct_movement, search_path) {
+    array2d<int> a = {{1,   1, -1, 1},
+                     {1,   1, -1, 1},
+                     {-1,  1, 1,  1},
+                     {1,   1, -1, 1}};
+
+    std::vector<vector2i> path;
+    nrg::search_path(a, {3, 0}, {0, 3}, path);
+
+    // The start is not part of the path
+    std::vector<vector2i> expected = {{3, 1}, {2, 1}, {2, 2}, {2, 3}, {1, 3}, {0, 3}};
+    ASSERT_EQ(expected, path);
+}
+
+TEST(direct_movement, search_path_prefers_fewer_turns) {
+    array2d<int> a(4, 4);
+
+    std::vector<vector2i> path;
+    nrg::search_path(a, {0, 0}, {3, 3}, path);
+
+    std::vector<vector2i> expected = {{0, 1}, {0, 2}, {0, 3}, {1, 3}, {2, 3}, {3, 3}};
+    ASSERT_EQ(expected, path);
+}
+
+TEST(direct_movement, search_path_unreachable) {
+    array2d<int> a = {{0, -1, 0},
+                     {0, -1, 0},
+                     {0, -1, 0}};
+
+    std::vector<vector2i> path;
+    nrg::search_path(a, {0, 0}, {0, 2}, path);
+
+    ASSERT_TRUE(path.empty());
+}
@@ -0,0 +1,27 @@
+#ifndef MINOTAUR_CPP_TESTFRAME_H
+#define MINOTAUR_CPP_TESTFRAME_H
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * Make a synthetic frame for a test, filled with a value and then drawn
+ * on. The frame is returned as a UMat that owns its pixels, as frames
+ * from the pipeline do.
+ *
+ * @param size frame dimensions
+ * @param type OpenCV type of the frame
+ * @param fill value of every pixel before drawing
+ * @param draw called with the frame to draw on it
+ */
+template<typename draw_t>
+cv::UMat test_frame(const cv::Size &size, int type, const cv::Scalar &fill, draw_t draw) {
+    cv::Mat frame(size, type, fill);
+    draw(frame);
+    return frame.getUMat(cv::ACCESS_READ).clone();
+}
+
+inline cv::UMat test_frame(const cv::Size &size, int type, const cv::Scalar &fill) {
+    return test_frame(size, type, fill, [](cv::Mat &) {});
+}
+
+#endif //MINOTAUR_CPP_TESTFRAME_H
@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+
+#include <code/utility/histogram.h>
+
+TEST(latency_histogram, bucket_bounds_contain_value) {
+    for (std::uint64_t us = 0; us < 100000; us += 7) {
+        std::size_t i = latency_histogram::bucket_of(us);
+        ASSERT_LE(us, latency_histogram::bucket_upper(i));
+        if (i > 0) { ASSERT_GT(us, latency_histogram::bucket_upper(i - 1)); }
+    }
+}
+
+TEST(latency_histogram, percentiles_within_bucket_error) {
+    latency_histogram hist;
+    for (std::uint64_t us = 1; us <= 1000; ++us) { hist.record(us); }
+    ASSERT_EQ(1000, hist.count());
+    ASSERT_EQ(1000, hist.max());
+    ASSERT_NEAR(500.5, hist.mean(), 1e-9);
+    ASSERT_NEAR(500, hist.percentile(50), 500 * 0.125);
+    ASSERT_NEAR(950, hist.percentile(95), 950 * 0.125);
+    ASSERT_NEAR(990, hist.percentile(99), 990 * 0.125);
+    ASSERT_EQ(1000, hist.percentile(100));
+}
+
+TEST(latency_histogram, empty_and_reset) {
+    latency_histogram hist;
+    ASSERT_EQ(0, hist.percentile(50));
+    hist.record(33000);
+    ASSERT_EQ(1, hist.count());
+    hist.reset();
+    ASSERT_EQ(0, hist.count());
+    ASSERT_EQ(0, hist.max());
+}
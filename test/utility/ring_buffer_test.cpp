@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <code/utility/ring_buffer.h>
+
+TEST(ring_buffer, push_pop_in_order) {
+    ring_buffer<int> ring(3);
+    ASSERT_TRUE(ring.empty());
+    ASSERT_TRUE(ring.push(1));
+    ASSERT_TRUE(ring.push(2));
+    ASSERT_EQ(2, ring.size());
+    int val = 0;
+    ASSERT_TRUE(ring.pop(val));
+    ASSERT_EQ(1, val);
+    ASSERT_TRUE(ring.pop(val));
+    ASSERT_EQ(2, val);
+    ASSERT_FALSE(ring.pop(val));
+    ASSERT_EQ(2, ring.pushed());
+    ASSERT_EQ(2, ring.popped());
+    ASSERT_EQ(0, ring.dropped());
+}
+
+TEST(ring_buffer, drop_oldest_keeps_newest) {
+    ring_buffer<int> ring(2, ring_buffer<int>::DROP_OLDEST);
+    ASSERT_TRUE(ring.push(1));
+    ASSERT_TRUE(ring.push(2));
+    ASSERT_FALSE(ring.push(3));
+    ASSERT_FALSE(ring.push(4));
+    ASSERT_EQ(2, ring.size());
+    ASSERT_EQ(2, ring.dropped());
+    int val = 0;
+    ASSERT_TRUE(ring.pop(val));
+    ASSERT_EQ(3, val);
+    ASSERT_TRUE(ring.pop(val));
+    ASSERT_EQ(4, val);
+    ASSERT_TRUE(ring.empty());
+}
+
+TEST(ring_buffer, drop_newest_keeps_oldest) {
+    ring_buffer<int> ring(2, ring_buffer<int>::DROP_NEWEST);
+    ASSERT_TRUE(ring.push(1));
+    ASSERT_TRUE(ring.push(2));
+    ASSERT_FALSE(ring.push(3));
+    ASSERT_EQ(1, ring.dropped());
+    int val = 0;
+    ASSERT_TRUE(ring.pop(val));
+    ASSERT_EQ(1, val);
+    ASSERT_TRUE(ring.pop(val));
+    ASSERT_EQ(2, val);
+}
+
+TEST(ring_buffer, wraps_around) {
+    ring_buffer<int> ring(3);
+    int val = 0;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(ring.push(i));
+        ASSERT_TRUE(ring.pop(val));
+        ASSERT_EQ(i, val);
+    }
+    ASSERT_EQ(0, ring.dropped());
+}
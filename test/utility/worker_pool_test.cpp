@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+
+#include <code/utility/worker_pool.h>
+
+TEST(worker_pool, runs_every_task) {
+    worker_pool pool(3);
+    std::vector<int> results(16, 0);
+    std::vector<worker_pool::task> tasks;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        tasks.emplace_back([&results, i] { results[i] = static_cast<int>(i) * 2; });
+    }
+    pool.run(tasks);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        ASSERT_EQ(static_cast<int>(i) * 2, results[i]);
+    }
+}
+
+TEST(worker_pool, no_workers_runs_on_caller) {
+    worker_pool pool(0);
+    ASSERT_EQ(0, pool.workers());
+    std::atomic<int> count(0);
+    std::vector<worker_pool::task> tasks(5, [&count] { ++count; });
+    pool.run(tasks);
+    ASSERT_EQ(5, count);
+    pool.run(std::vector<worker_pool::task>());
+    ASSERT_EQ(5, count);
+}
+
+TEST(worker_pool, rethrows_after_batch) {
+    worker_pool pool(2);
+    std::atomic<int> count(0);
+    std::vector<worker_pool::task> tasks(4, [&count] { ++count; });
+    tasks.emplace_back([] { throw std::runtime_error("task failed"); });
+    ASSERT_THROW(pool.run(tasks), std::runtime_error);
+    ASSERT_EQ(4, count);
+    // The pool is still usable afterwards
+    tasks.pop_back();
+    pool.run(tasks);
+    ASSERT_EQ(8, count);
+}
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include <code/video/boxfilter.h>
+
+TEST(box_filter, first_measurement_is_not_moving) {
+    BoxFilter filter;
+    ASSERT_FALSE(filter.motion().valid);
+    pipeline_clock::time_point t = pipeline_clock::now();
+    filter.update({10, 20, 16, 16}, t);
+    const TargetMotion &motion = filter.motion();
+    ASSERT_TRUE(motion.valid);
+    ASSERT_DOUBLE_EQ(10, motion.box.x);
+    ASSERT_DOUBLE_EQ(20, motion.box.y);
+    ASSERT_DOUBLE_EQ(0, motion.velocity.x);
+    ASSERT_DOUBLE_EQ(10, motion.predict(t + std::chrono::seconds(1)).x);
+    filter.reset();
+    ASSERT_FALSE(filter.motion().valid);
+}
+
+TEST(box_filter, tracks_constant_velocity) {
+    BoxFilter filter;
+    pipeline_clock::time_point start = pipeline_clock::now();
+    // 120 px/s to the right and 60 px/s down at 30 frames per second
+    for (int i = 0; i < 90; ++i) {
+        double s = i / 30.0;
+        auto t = start + std::chrono::microseconds(static_cast<std::int64_t>(s * 1e6));
+        filter.update({100 + 120 * s, 50 + 60 * s, 20, 20}, t);
+    }
+    const TargetMotion &motion = filter.motion();
+    ASSERT_NEAR(120, motion.velocity.x, 1.0);
+    ASSERT_NEAR(60, motion.velocity.y, 1.0);
+    ASSERT_NEAR(20, motion.box.width, 0.1);
+    // Predict half a second ahead
+    cv::Rect2d ahead = motion.predict(motion.time + std::chrono::milliseconds(500));
+    ASSERT_NEAR(motion.box.x + 60, ahead.x, 0.5);
+    ASSERT_NEAR(motion.box.y + 30, ahead.y, 0.5);
+    ASSERT_GT(motion.covariance(0, 0), 0);
+}
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc.hpp>
+
+#include <code/video/centroid.h>
+#include <test/testframe.h>
+
+// A bright disc on a dark floor, drawn with subpixel precision
+static cv::UMat disc_frame(const cv::Point2d &center, double radius) {
+    return test_frame(cv::Size(160, 120), CV_8UC3, cv::Scalar::all(40), [&](cv::Mat &frame) {
+        const int shift = 8;
+        const double one = 1 << shift;
+        // Drawing coordinates are about pixel centers
+        cv::Point c(cvRound((center.x - 0.5) * one), cvRound((center.y - 0.5) * one));
+        cv::circle(frame, c, cvRound(radius * one), cv::Scalar(60, 220, 90), cv::FILLED, cv::LINE_AA, shift);
+    });
+}
+
+TEST(centroid, refines_box_center_to_subpixel) {
+    const cv::Point2d truth(70.3, 52.7);
+    cv::UMat frame = disc_frame(truth, 10);
+    // Box aligned to whole pixels, as trackers report
+    cv::Rect2d box(58, 40, 26, 26);
+    cv::Point2d center;
+    ASSERT_TRUE(contrast_centroid(frame, box, center));
+    ASSERT_NEAR(truth.x, center.x, 0.1);
+    ASSERT_NEAR(truth.y, center.y, 0.1);
+    cv::Point2d box_center(box.x + box.width / 2, box.y + box.height / 2);
+    ASSERT_GT(cv::norm(box_center - truth), 0.5);
+}
+
+TEST(centroid, ignores_boxes_without_contrast) {
+    cv::Mat flat(120, 160, CV_8UC1, cv::Scalar(100));
+    cv::Point2d center(-1, -1);
+    ASSERT_FALSE(contrast_centroid(flat.getUMat(cv::ACCESS_READ), cv::Rect2d(10, 10, 30, 30), center));
+    ASSERT_EQ(-1, center.x);
+    // Boxes outside the frame
+    ASSERT_FALSE(contrast_centroid(flat.getUMat(cv::ACCESS_READ), cv::Rect2d(200, 10, 30, 30), center));
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc.hpp>
+
+#include <code/video/flowvelocity.h>
+#include <test/testframe.h>
+
+// A textured target on a plain floor
+static cv::UMat target_frame(const cv::Point &tl) {
+    return test_frame(cv::Size(320, 240), CV_8UC1, cv::Scalar(90), [&tl](cv::Mat &frame) {
+        cv::Mat texture(40, 40, CV_8UC1);
+        cv::RNG rng(7);
+        rng.fill(texture, cv::RNG::UNIFORM, 0, 255);
+        cv::GaussianBlur(texture, texture, cv::Size(5, 5), 1.0);
+        texture.copyTo(frame(cv::Rect(tl, texture.size())));
+    });
+}
+
+TEST(flow_velocity, measures_displacement_and_velocity) {
+    FlowVelocity flow;
+    pipeline_clock::time_point t0 = pipeline_clock::now();
+    pipeline_clock::time_point t1 = t0 + std::chrono::milliseconds(50);
+    TargetFlow first = flow.update(target_frame({100, 80}), cv::Rect2d(100, 80, 40, 40), 1.0, t0);
+    ASSERT_FALSE(first.valid);
+    TargetFlow second = flow.update(target_frame({103, 78}), cv::Rect2d(103, 78, 40, 40), 1.0, t1);
+    ASSERT_TRUE(second.valid);
+    ASSERT_GE(second.points, static_cast<int>(FlowVelocity::MIN_POINTS));
+    ASSERT_NEAR(3.0, second.displacement.x, 0.1);
+    ASSERT_NEAR(-2.0, second.displacement.y, 0.1);
+    ASSERT_NEAR(60.0, second.velocity.x, 2.0);
+    ASSERT_NEAR(-40.0, second.velocity.y, 2.0);
+    ASSERT_NEAR(0.05, second.interval, 1e-9);
+}
+
+TEST(flow_velocity, ignores_box_jitter) {
+    FlowVelocity flow;
+    pipeline_clock::time_point t0 = pipeline_clock::now();
+    flow.update(target_frame({100, 80}), cv::Rect2d(100, 80, 40, 40), 1.0, t0);
+    // The target stays put while its box jumps
+    TargetFlow still = flow.update(target_frame({100, 80}), cv::Rect2d(104, 77, 40, 40), 1.0,
+                                   t0 + std::chrono::milliseconds(50));
+    ASSERT_TRUE(still.valid);
+    ASSERT_NEAR(0.0, still.displacement.x, 0.05);
+    ASSERT_NEAR(0.0, still.displacement.y, 0.05);
+}
+
+TEST(flow_velocity, reports_full_resolution_and_resets) {
+    FlowVelocity flow;
+    pipeline_clock::time_point t0 = pipeline_clock::now();
+    // Analysis at half scale, boxes in full resolution
+    flow.update(target_frame({100, 80}), cv::Rect2d(200, 160, 80, 80), 0.5, t0);
+    TargetFlow moved = flow.update(target_frame({102, 80}), cv::Rect2d(204, 160, 80, 80), 0.5,
+                                   t0 + std::chrono::milliseconds(100));
+    ASSERT_TRUE(moved.valid);
+    ASSERT_NEAR(4.0, moved.displacement.x, 0.2);
+    // A scale change starts over
+    TargetFlow rescaled = flow.update(target_frame({102, 80}), cv::Rect2d(102, 80, 40, 40), 1.0,
+                                      t0 + std::chrono::milliseconds(150));
+    ASSERT_FALSE(rescaled.valid);
+}
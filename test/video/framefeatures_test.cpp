@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc.hpp>
+
+#include <code/utility/worker_pool.h>
+#include <code/video/framefeatures.h>
+#include <test/testframe.h>
+
+static cv::UMat color_frame() {
+    return test_frame(cv::Size(80, 64), CV_8UC3, cv::Scalar(40, 120, 200), [](cv::Mat &frame) {
+        cv::rectangle(frame, cv::Rect(20, 16, 24, 24), cv::Scalar(250, 250, 250), cv::FILLED);
+    });
+}
+
+TEST(frame_features, computes_each_feature_once) {
+    FrameFeatures frame(color_frame());
+    const cv::UMat &gray = frame.gray();
+    ASSERT_EQ(1, gray.channels());
+    ASSERT_EQ(frame.image().size(), gray.size());
+    ASSERT_EQ(&gray, &frame.gray());
+    ASSERT_EQ(&frame.hsv(), &frame.hsv());
+    ASSERT_EQ(&frame.edges(0, 50, 5), &frame.edges(0, 50, 5));
+    ASSERT_NE(&frame.edges(0, 50, 5), &frame.edges(0, 100, 5));
+    ASSERT_EQ(&frame.image(), &frame.pyramid(0));
+}
+
+TEST(frame_features, gray_frame_is_its_own_gray) {
+    cv::UMat gray;
+    cv::cvtColor(color_frame(), gray, cv::COLOR_BGR2GRAY);
+    FrameFeatures frame(gray);
+    ASSERT_EQ(&frame.image(), &frame.gray());
+}
+
+TEST(frame_features, pyramid_levels_halve) {
+    FrameFeatures frame(color_frame());
+    // Asking for a deeper level first must not invalidate earlier ones
+    const cv::UMat &level2 = frame.pyramid(2);
+    const cv::UMat &level1 = frame.pyramid(1);
+    ASSERT_EQ(cv::Size(40, 32), level1.size());
+    ASSERT_EQ(cv::Size(20, 16), level2.size());
+    ASSERT_EQ(&level1, &frame.pyramid(1));
+    ASSERT_EQ(frame.image().size(), frame.smoothed(0).size());
+    ASSERT_EQ(level1.size(), frame.smoothed(1).size());
+}
+
+TEST(frame_features, concurrent_callers_share_results) {
+    FrameFeatures frame(color_frame());
+    worker_pool pool(4);
+    std::vector<const cv::UMat *> grays(8);
+    std::vector<worker_pool::task> tasks;
+    for (std::size_t i = 0; i < grays.size(); ++i) {
+        tasks.emplace_back([&frame, &grays, i] {
+            frame.edges(0, 50, 5);
+            frame.smoothed(i % 2);
+            grays[i] = &frame.gray();
+        });
+    }
+    pool.run(tasks);
+    for (const cv::UMat *gray : grays) {
+        ASSERT_EQ(&frame.gray(), gray);
+    }
+}
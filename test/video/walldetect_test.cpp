@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc.hpp>
+
+#include <code/gui/griddisplay.h>
+#include <code/utility/array2d.h>
+#include <code/video/walldetect.h>
+#include <test/testframe.h>
+
+typedef CompetitionState::wall_arr wall_arr;
+
+static cv::UMat floor_frame() {
+    return test_frame(cv::Size(100, 100), CV_8UC1, cv::Scalar(200));
+}
+
+static void add_wall(cv::UMat &frame, const cv::Rect &rect) {
+    cv::rectangle(frame, rect, cv::Scalar(20), cv::FILLED);
+}
+
+TEST(wall_detect, classifies_cells_and_skips_unchanged) {
+    ASSERT_EQ(10, GridDisplay::grid_size());
+    WallDetect detect;
+    std::shared_ptr<wall_arr> walls;
+    int events = 0;
+    QObject::connect(&detect, &WallDetect::walls_changed, [&](const std::shared_ptr<wall_arr> &w) {
+        walls = w;
+        ++events;
+    });
+
+    cv::UMat frame = floor_frame();
+    add_wall(frame, {40, 40, 20, 20});
+    detect.analyze(frame, 1.0);
+    ASSERT_EQ(1, events);
+    ASSERT_EQ(100, detect.recomputed());
+    ASSERT_EQ(10, walls->x());
+    ASSERT_EQ(10, walls->y());
+    for (int x = 0; x < 10; ++x) {
+        for (int y = 0; y < 10; ++y) {
+            bool wall = (x == 4 || x == 5) && (y == 4 || y == 5);
+            ASSERT_EQ(wall, (*walls)[x][y]) << x << ", " << y;
+        }
+    }
+
+    // Nothing is classified again, nor published, for the same frame
+    detect.analyze(frame, 1.0);
+    ASSERT_EQ(0, detect.recomputed());
+    ASSERT_EQ(1, events);
+
+    // Only the changed cell is classified again
+    add_wall(frame, {80, 10, 10, 10});
+    detect.analyze(frame, 1.0);
+    ASSERT_EQ(1, detect.recomputed());
+    ASSERT_EQ(2, events);
+    ASSERT_TRUE((*walls)[8][1]);
+    ASSERT_TRUE((*walls)[4][4]);
+}
+
+TEST(wall_detect, cells_are_full_resolution_sized) {
+    WallDetect detect;
+    std::shared_ptr<wall_arr> walls;
+    QObject::connect(&detect, &WallDetect::walls_changed, [&](const std::shared_ptr<wall_arr> &w) {
+        walls = w;
+    });
+    cv::UMat frame = floor_frame();
+    add_wall(frame, {20, 20, 10, 10});
+    // A 100x100 analysis frame at half scale covers a 200x200 frame
+    detect.analyze(frame, 0.5);
+    ASSERT_EQ(20, walls->x());
+    ASSERT_EQ(20, walls->y());
+    ASSERT_TRUE((*walls)[4][4]);
+    ASSERT_TRUE((*walls)[5][5]);
+    ASSERT_FALSE((*walls)[6][6]);
+}